@@ -13,8 +13,10 @@
 #include "common.h"
 
 #include "cmsis_os2.h"
+#include "si91x_device.h"
 
 osEventFlagsId_t event_flags;
+volatile uint32_t log_cycles = 0;
 
 void common_init(void)
 {
@@ -23,14 +25,19 @@ void common_init(void)
 
 void delay_ns(uint32_t ns)
 {
-  volatile int32_t timeout = (ns - 110000) * 119 / 1000 / 7;
-//  volatile int32_t timeout = ns * 100 / 1000 / 7;
-
-  do {
-      timeout--;
-  } while (timeout > 0);
-
-//  delay_ms(2 + ns / 1000000);
+  // Busy wait on the DWT cycle counter at the current core clock, rounded up to whole cycles
+  uint32_t cycles = (uint32_t)(((uint64_t)ns * SystemCoreClock + 999999999) / 1000000000);
+
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+  {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+
+  uint32_t start = DWT->CYCCNT;
+  while (DWT->CYCCNT - start < cycles)
+  {
+  }
 }
 
 void delay_ms(uint32_t ms)
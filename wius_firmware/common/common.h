@@ -66,7 +66,8 @@ void common_init(void);
  *
  * @param ns Number of nanoseconds to delay
  *
- * @note This function is not very accurate
+ * @note Busy waits on the DWT cycle counter, accurate to a few cycles plus interrupts taken
+ *       meanwhile
  *
  */
 void delay_ns(uint32_t ns);
@@ -40,6 +40,14 @@
 /** @}
  */
 
+/** @name WiUS UDP configurations
+ * @{
+ */
+#define WIUS_UDP_TX_QUEUE_DEPTH 4     /**< Maximum number of asynchronous sends in flight */
+#define WIUS_UDP_TX_TIMEOUT_MS 500    /**< Time after which an asynchronous send without completion is reclaimed */
+/** @}
+ */
+
 /**
  * @name WiUS logging configurations
  * @{
@@ -64,7 +72,10 @@
 #define TP_PROBE_ID 1               /**< ID of the probe */
 #define TP_WIFI_RX_BUFFER_SIZE 1472 /**< Size of the WiFi RX buffer */
 #define TP_UDP_PACKET_SIZE 1000     /**< Size of one UDP packet (without header) */
-#define TP_UDP_PORT 50007           /**< Port on which UDP transfers happen */
+#define TP_UDP_PORT 50007           /**< Port on which commands are received and replied (control port) */
+#define TP_UDP_DATA_PORT 50008      /**< Local port from which acquired data is sent (data port) */
+#define TP_UDP_TX_TIMEOUT_MS 100    /**< Timeout for queueing and flushing data packets in ms */
+#define TP_UDP_TX_BATCH 3           /**< Number of data packets read before they are sent together */
 #define TP_GPIO_INT 2               /**< FPGA Interrupt UULP gpio number */
 #define TP_GPIO_RESET 10            /**< FPGA Reset ULP gpio number */
 #define TP_THREAD_STACK_MAIN 4096   /**< Stack of main thread */
@@ -80,24 +91,144 @@
  */
 
 /** @name TinyProbe buffering configurations
+ *
+ * The ring takes (TP_BUFFER_NUM + 1) regions of TP_BUFFER_REGION_SIZE bytes of RAM, with the
+ * defaults 41 * 1052 = 43132 bytes. Every retransmit cache packet adds one region.
+ *
  * @{
  */
-#define TP_BUFFER_NUM 2     /**< Number of buffers available */
-#define TP_BUFFER_SIZE 2048 /**< Size of one buffer in bytes */
+#define TP_BUFFER_NUM (8 + TP_RETX_CACHE_PACKETS) /**< Number of buffers available (live data and retransmit cache) */
+#define TP_BUFFER_ALIGN 4       /**< Alignment of the buffer regions in bytes (DMA) */
+#define TP_BUFFER_HEADROOM 32   /**< Space reserved in front of the DMA landing zone for headers */
+#define TP_BUFFER_TAILROOM 16   /**< Space reserved after the SPI transfer for trailers (CRC, FEC) */
+#define TP_BUFFER_REGION_SIZE ((TP_BUFFER_HEADROOM + TP_UDP_PACKET_SIZE + 2 + TP_BUFFER_TAILROOM + TP_BUFFER_ALIGN - 1) & ~(TP_BUFFER_ALIGN - 1)) /**< Size of the largest region (headroom, SPI transfer with status and tailroom) */
+#define TP_BUFFER_RING_SIZE ((TP_BUFFER_NUM + 1) * TP_BUFFER_REGION_SIZE) /**< Size of the buffer ring in bytes (one region lost when it wraps) */
+#define TP_BUFFER_TIMEOUT_MS 50 /**< Timeout for claiming a buffer for writing in ms */
 /** @}
  */
 
 /** @name TinyProbe commands configurations
  * @{
  */
-#define TP_COMMAND_MAX 2048 /**< Maximum number of commands per WiFi package */
+#define TP_COMMAND_MAX 2048          /**< Maximum number of commands per WiFi package */
+#define TP_COMMAND_LOOP_DEPTH 4       /**< Maximum nesting depth of LOOP commands */
+#define TP_COMMAND_NUM_PARAMS 8       /**< Number of parameters for SET_PARAM / WRITE_PARAM */
+#define TP_COMMAND_MAX_EXEC_MS 60000  /**< Maximum execution time of a command list in ms (0 for no limit) */
+#define TP_COMMAND_ARENA_SIZE 4096    /**< Size of the buffer for arguments expanded from compact commands */
+/** @}
+ */
+
+/** @name TinyProbe command program configurations
+ * @{
+ */
+#define TP_PROGRAM_NUM 4            /**< Number of program slots */
+#define TP_PROGRAM_MAX_COMMANDS 128 /**< Maximum number of commands per program */
+#define TP_PROGRAM_MAX_ARGS 1024    /**< Size of the argument storage per program in bytes */
+#define TP_PROGRAM_FLASH 0          /**< Persist programs to flash (requires the NVM3 component) */
+/** @}
+ */
+
+/** @name TinyProbe thread configurations
+ * @{
+ */
+#define TP_CONTROL_THREAD_PRIORITY osPriorityAboveNormal /**< Priority of the control (command receive) thread */
+#define TP_CONTROL_THREAD_STACK 2048                     /**< Stack size of the control thread in bytes */
+#define TP_RETX_THREAD_PRIORITY osPriorityLow            /**< Priority of the retransmit thread */
+#define TP_LINK_THREAD_PRIORITY osPriorityLow            /**< Priority of the link monitor thread */
+#define TP_COMMAND_QUEUE_SIZE 2                          /**< Number of command batches waiting for the main thread */
+#define TP_COMMAND_IMMEDIATE_MAX 16                      /**< Maximum number of commands in a batch executed on the control thread */
+#define TP_COMMAND_IMMEDIATE_ARGS (4 + (TP_RETX_CACHE_PACKETS + 7) / 8)                  /**< Longest immediate arguments, a NACK covering the retransmit cache (PACING 5, CREDIT 6, SUBSCRIBE 7) */
+#define TP_COMMAND_IMMEDIATE_ARENA_SIZE (TP_COMMAND_IMMEDIATE_MAX * TP_COMMAND_IMMEDIATE_ARGS) /**< Size of the buffer for arguments expanded from compact immediate batches */
+/** @}
+ */
+
+/** @name TinyProbe retransmission configurations
+ * @{
+ */
+#define TP_RETX_CACHE_PACKETS 32 /**< Number of sent data packets kept for retransmission (one buffer each) */
+#define TP_RETX_CACHE_SHOTS 2    /**< Number of most recent shots kept for retransmission */
+#define TP_RETX_QUEUE_SIZE 16    /**< Maximum number of packets waiting for retransmission */
+#define TP_RETX_COPIES 2         /**< Number of retransmissions in flight (private packet copy each) */
+/** @}
+ */
+
+/** @name TinyProbe forward error correction configurations
+ * @{
+ */
+#define TP_FEC_K 8     /**< Default number of data packets per FEC group */
+#define TP_FEC_M 0     /**< Default number of parity packets per FEC group (0 to disable) */
+#define TP_FEC_MAX_M 4 /**< Maximum number of parity packets per FEC group */
+/** @}
+ */
+
+/** @name TinyProbe transmit pacing configurations
+ * @{
+ */
+#define TP_PACING_MODE 2              /**< Default pacing mode (0: off, 1: fixed rate, 2: adaptive) */
+#define TP_PACING_RATE 2000000        /**< Default (start) rate in bytes/s */
+#define TP_PACING_RATE_MIN 100000     /**< Minimum adaptive rate in bytes/s */
+#define TP_PACING_RATE_MAX 8000000    /**< Maximum adaptive rate in bytes/s */
+#define TP_PACING_RATE_STEP 50000     /**< Additive rate increase per uncongested send in bytes/s */
+#define TP_PACING_BURST 4096          /**< Token bucket depth in bytes */
+#define TP_PACING_LATENCY_US 2000     /**< Send latency above which the link counts as congested in us */
+/** @}
+ */
+
+/** @name TinyProbe flow control configurations
+ * @{
+ */
+#define TP_CREDIT_MODE 0       /**< Default flow control mode (0: push, 1: pull and drop, 2: pull and buffer) */
+#define TP_CREDIT_UNIT 0       /**< Default credit unit (0: datagrams, 1: bytes) */
+#define TP_CREDIT_WAIT_MS 100  /**< Maximum time a shot waits for credit in pull and buffer mode */
+/** @}
+ */
+
+/** @name TinyProbe WiFi performance profile configurations
+ * @{
+ */
+#define TP_PERF_IDLE_TIMEOUT_MS 5000   /**< Time without acquisition before leaving high performance in ms */
+#define TP_PERF_IDLE_LOW_LATENCY 0     /**< Whether to idle in low latency power save instead of power save */
+#define TP_PERF_CLOCK_GOVERNOR 1       /**< Whether to pick the core clock from the acquisition load (0: always high) */
+#define TP_PERF_CLOCK_HIGH_BYTES 16384 /**< Expected acquisition size from which the high core clock is used */
+/** @}
+ */
+
+/** @name TinyProbe target wake time configurations
+ * @{
+ */
+#define TP_TWT_PACKET_AIRTIME_US 250  /**< Airtime budget of one data packet including retries in us */
+#define TP_TWT_GUARD_US 2000          /**< Service period margin for wake up and tick granularity in us */
+#define TP_TWT_ALIGN 0                /**< Whether to also delay shots on the M4 to a guessed service period (0: rely on the network processor) */
+/** @}
+ */
+
+/** @name TinyProbe link monitor configurations
+ * @{
+ */
+#define TP_LINK_PERIOD_MS 1000  /**< Link sampling period in ms */
+#define TP_LINK_ADAPT 1         /**< Whether the data path follows the link state by default */
+#define TP_LINK_RSSI_MIN -75    /**< Signal strength below which the link is degraded in dBm */
+#define TP_LINK_RETRY_MAX 300   /**< Retransmissions per frame above which the link is degraded in permille */
+#define TP_LINK_GOOD_SAMPLES 5  /**< Good samples in a row before leaving the degraded state */
+#define TP_LINK_FEC_K 8         /**< Data packets per parity group while degraded */
+#define TP_LINK_FEC_M 1         /**< Parity packets per group while degraded */
+/** @}
+ */
+
+/** @name TinyProbe subscriber configurations
+ * @{
+ */
+#define TP_SUBSCRIBER_MAX 4  /**< Maximum number of unicast data stream subscribers */
 /** @}
  */
 
 /** @name TinyProbe FPGA control configurations
  * @{
  */
-#define TP_FPGA_SPI_DELAY_NS 50 /**< Delay after SPI transfers in ns */
+#define TP_FPGA_SPI_DELAY_NS 50   /**< Delay after SPI transfers in ns */
+#define TP_FPGA_READY_HANDSHAKE 0 /**< Whether the bitstream reports readout data ready in the configuration register */
+#define TP_FPGA_FIFO_LEVEL 0      /**< Whether the bitstream reports the FIFO fill level after the configuration register */
+#define TP_FPGA_READY_POLLS 64    /**< Maximum configuration register reads while waiting for readout data */
 /** @}
  */
 
@@ -112,10 +243,15 @@
 /** @name TinyProbe power control configurations
  * @{
  */
-#define TP_POWER_GPIO_NEG_5V 2      /**< -5V ULP gpio number */
-#define TP_POWER_GPIO_NEG_HV 52     /**< -HV gpio number */
-#define TP_POWER_GPIO_POS_HV 56     /**< +HV gpio number */
-#define TP_POWER_GPIO_LVDS_PWR_SW 8 /**< LVDS power switch ULP gpio number */
+#define TP_POWER_GPIO_NEG_5V 2        /**< -5V ULP gpio number */
+#define TP_POWER_GPIO_NEG_HV 52       /**< -HV gpio number */
+#define TP_POWER_GPIO_POS_HV 56       /**< +HV gpio number */
+#define TP_POWER_GPIO_LVDS_PWR_SW 8   /**< LVDS power switch ULP gpio number */
+#define TP_POWER_WARM_MS UINT32_MAX   /**< Time in warm standby before LVDS, high voltage and -5V are gated in ms (UINT32_MAX: never) */
+#define TP_POWER_SETTLE_LVDS_MS 10    /**< Settle time after enabling LVDS 2.5V in ms */
+#define TP_POWER_SETTLE_POS_HV_MS 0   /**< Settle time after enabling +HV in ms (settles together with -HV) */
+#define TP_POWER_SETTLE_NEG_HV_MS 100 /**< Settle time after enabling -HV in ms */
+#define TP_POWER_SETTLE_NEG_5V_MS 100 /**< Settle time after enabling -5V in ms */
 /** @}
  */
 
@@ -127,6 +263,7 @@
 #define FLAG_SPI_TF0_DONE (1 << 2)    /**< SPI instance 0 transfer done flag */
 #define FLAG_SPI_TF1_DONE (1 << 3)    /**< SPI instance 1 transfer done flag */
 #define FLAG_FIFO_DATA_READY (1 << 4) /**< FIFO data ready flag */
+#define FLAG_CREDIT_GRANTED (1 << 5)  /**< Flow control credit granted flag */
 /** @}
  */
 
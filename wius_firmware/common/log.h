@@ -18,6 +18,7 @@
 #include "sys.h"
 #include "cmsis_os2.h"
 #include "os_tick.h"
+#include "si91x_device.h"
 
 #include "config.h"
 
@@ -51,6 +52,8 @@
 #define LOG_E(...)
 #endif
 
+extern volatile uint32_t log_cycles; // Cycles spent printing log messages (DWT cycle counter)
+
 #define ASSERT(x, ...) _LOG_ASSERT(x, #x, ##__VA_ARGS__) // Assert macro
 
 #define _LOG_ASSERT(x, x_str, ...)                                  \
@@ -66,12 +69,14 @@
         }                                                           \
     } while (false)
 
-#define _LOG_PRINT(level, ...)                                                \
-    do                                                                        \
-    {                                                                         \
-        printf("[%s %7lu %27s]   ", level, osKernelGetTickCount(), __func__); \
-        printf(__VA_ARGS__);                                                  \
-        printf("\n\r");                                                       \
+#define _LOG_PRINT(level, ...)                                                       \
+    do                                                                               \
+    {                                                                                \
+        uint32_t _log_start = DWT->CYCCNT;                                           \
+        printf("[%s %7lu %27s]   ", level, osKernelGetTickCount(), __func__);        \
+        printf(__VA_ARGS__);                                                         \
+        printf("\n\r");                                                              \
+        __atomic_fetch_add(&log_cycles, DWT->CYCCNT - _log_start, __ATOMIC_RELAXED); \
     } while (0)
 
 #endif /* LOG_H_ */
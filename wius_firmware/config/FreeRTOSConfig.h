@@ -82,7 +82,18 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //  <q>Use TICKLESS IDLE for Energy Management
 //  <i> Enable setting to use Tickless Idle.
 //  <i> Default: 0
-#define configUSE_TICKLESS_IDLE 0
+#define configUSE_TICKLESS_IDLE 1
+
+//  <o>Expected idle time before sleep <2-1000>
+//  <i> Minimum number of idle ticks before the kernel suppresses the tick and sleeps.
+//  <i> Default: 70
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP 70
+
+#if (configUSE_TICKLESS_IDLE == 1)
+// Hand idle periods to the SiWx91x power manager, which asks app_is_ok_to_sleep() before sleeping
+extern void sli_si91x_sleep_wakeup(uint16_t xExpectedIdleTime);
+#define configPRE_SLEEP_PROCESSING(x) sli_si91x_sleep_wakeup(x)
+#endif
 
 //  <q>Idle should yield
 //  <i> Control Yield behaviour of the idle task.
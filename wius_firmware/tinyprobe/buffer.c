@@ -12,78 +12,216 @@
 
 #include "buffer.h"
 
-void tp_buffer_init(tp_buffer_t *buf)
+#include "si91x_device.h"
+
+#if TP_BUFFER_HEADROOM + TP_UDP_PACKET_SIZE + 2 + TP_BUFFER_TAILROOM > TP_BUFFER_RING_SIZE
+#error "TP_BUFFER_RING_SIZE too small for headroom, SPI transfer and tailroom"
+#endif
+
+#if TP_BUFFER_HEADROOM % TP_BUFFER_ALIGN
+#error "TP_BUFFER_HEADROOM must keep the DMA landing zone aligned"
+#endif
+
+// Slots are shared with transmit completions, which may run in another context
+#define _TP_BUFFER_LOCK()            \
+  uint32_t _primask = __get_PRIMASK(); \
+  __disable_irq()
+#define _TP_BUFFER_UNLOCK() __set_PRIMASK(_primask)
+
+// Must be called with the lock held
+tp_buffer_slot_t *_tp_buffer_alloc(tp_buffer_t *buf, size_t size)
+{
+  if (0 == buf->num_free || size > TP_BUFFER_RING_SIZE)
+  {
+    return NULL;
+  }
+
+  size_t start;
+
+  if (0 == buf->regions_count)
+  {
+    // Empty ring, start over at the beginning
+    buf->write = 0;
+    buf->wrap = 0;
+    start = 0;
+  }
+  else
+  {
+    size_t read = buf->regions[buf->regions_head]->data - buf->ring;
+
+    if (0 == buf->wrap && buf->write + size <= TP_BUFFER_RING_SIZE)
+    {
+      start = buf->write;
+    }
+    else if (0 == buf->wrap && size <= read)
+    {
+      // Skip the rest of the ring, it is reclaimed together with the oldest region
+      buf->wrap = buf->write;
+      start = 0;
+    }
+    else if (0 != buf->wrap && buf->write + size <= read)
+    {
+      start = buf->write;
+    }
+    else
+    {
+      return NULL;
+    }
+  }
+
+  buf->write = start + size;
+
+  tp_buffer_slot_t *slot = buf->free_slots[--buf->num_free];
+  slot->data = buf->ring + start;
+  slot->size = size;
+  buf->regions[(buf->regions_head + buf->regions_count++) % TP_BUFFER_NUM] = slot;
+
+  return slot;
+}
+
+// Must be called with the lock held, returns whether a region was reclaimed
+bool _tp_buffer_reclaim(tp_buffer_t *buf)
 {
-  memset(buf->slots, 0, sizeof(buf->slots));
+  bool reclaimed = false;
 
+  while (buf->regions_count > 0 && TP_BUFFER_FREE == buf->regions[buf->regions_head]->status)
+  {
+    tp_buffer_slot_t *slot = buf->regions[buf->regions_head];
+    buf->regions_head = (buf->regions_head + 1) % TP_BUFFER_NUM;
+    buf->regions_count--;
+    buf->free_slots[buf->num_free++] = slot;
+    reclaimed = true;
+
+    // The read end followed the write end to the beginning of the ring
+    if (buf->regions_count > 0 && buf->regions[buf->regions_head]->data < slot->data)
+    {
+      buf->wrap = 0;
+    }
+  }
+
+  return reclaimed;
+}
+
+void tp_buffer_init(tp_buffer_t *buf)
+{
   buf->head = 0;
   buf->tail = 0;
   buf->count = 0;
+  buf->num_free = TP_BUFFER_NUM;
+  buf->regions_head = 0;
+  buf->regions_count = 0;
+  buf->write = 0;
+  buf->wrap = 0;
 
   for (size_t i = 0; i < TP_BUFFER_NUM; i++)
   {
     buf->slots[i].status = TP_BUFFER_FREE;
-    buf->slots[i].length = TP_BUFFER_SIZE;
+    buf->slots[i].refs = 0;
+    buf->slots[i].data = NULL;
+    buf->slots[i].size = 0;
+    buf->slots[i].offset = TP_BUFFER_HEADROOM;
+    buf->slots[i].length = 0;
+    buf->free_slots[i] = &buf->slots[i];
   }
-}
 
-tp_buffer_slot_t *tp_buffer_claim_writing(tp_buffer_t *buf)
-{
-  if (buf->count >= TP_BUFFER_NUM)
+  if (NULL == buf->released)
   {
-    return NULL;
+    buf->released = osSemaphoreNew(1, 0, NULL);
+    return;
   }
 
-  tp_buffer_slot_t *slot = &buf->slots[buf->tail];
-  if (slot->status != TP_BUFFER_FREE)
+  while (osOK == osSemaphoreAcquire(buf->released, 0))
   {
-    return NULL;
+  }
+}
+
+tp_buffer_slot_t *tp_buffer_claim_writing(tp_buffer_t *buf, size_t size)
+{
+  size = (TP_BUFFER_HEADROOM + size + TP_BUFFER_TAILROOM + TP_BUFFER_ALIGN - 1) & ~(size_t)(TP_BUFFER_ALIGN - 1);
+
+  uint32_t timeout_ticks = (TP_BUFFER_TIMEOUT_MS * TICKS_PER_SEC + 999) / 1000;
+  uint32_t start = osKernelGetTickCount();
+  tp_buffer_slot_t *slot;
+
+  while (1)
+  {
+    _TP_BUFFER_LOCK();
+    slot = _tp_buffer_alloc(buf, size);
+    _TP_BUFFER_UNLOCK();
+
+    if (NULL != slot)
+    {
+      break;
+    }
+
+    // Wait for older regions to be reclaimed
+    uint32_t waited = osKernelGetTickCount() - start;
+    if (waited >= timeout_ticks || osOK != osSemaphoreAcquire(buf->released, timeout_ticks - waited))
+    {
+      return NULL;
+    }
   }
 
   slot->status = TP_BUFFER_INUSE;
-  buf->tail = (buf->tail + 1) % TP_BUFFER_NUM;
+  slot->refs = 1;
+  slot->offset = TP_BUFFER_HEADROOM;
+  slot->length = 0;
 
   return slot;
 }
-
 tp_buffer_slot_t *tp_buffer_claim_reading(tp_buffer_t *buf)
 {
-  if (buf->count == 0)
-  {
-    return NULL;
-  }
+  tp_buffer_slot_t *slot = NULL;
 
-  tp_buffer_slot_t *slot = &buf->slots[buf->head];
-  if (slot->status != TP_BUFFER_FILLED)
+  _TP_BUFFER_LOCK();
+  if (buf->count > 0)
   {
-    return NULL;
+    slot = buf->filled[buf->head];
+    buf->head = (buf->head + 1) % TP_BUFFER_NUM;
+    buf->count--;
+    slot->status = TP_BUFFER_INUSE;
   }
-
-  slot->status = TP_BUFFER_INUSE;
+  _TP_BUFFER_UNLOCK();
 
   return slot;
 }
 
 void tp_buffer_return(tp_buffer_t *buf, tp_buffer_slot_t *slot, bool discard)
 {
-  if (slot)
+  if (NULL == slot)
   {
-    slot->status = discard ? TP_BUFFER_FREE : TP_BUFFER_FILLED;
+    return;
   }
 
+  bool released = false;
+
+  _TP_BUFFER_LOCK();
   if (discard)
   {
-    buf->count--;
-    buf->head = (buf->head + 1) % TP_BUFFER_NUM;
-    slot->length = TP_BUFFER_SIZE;
+    if (0 == --slot->refs)
+    {
+      slot->status = TP_BUFFER_FREE;
+      released = _tp_buffer_reclaim(buf);
+    }
   }
   else
   {
+    slot->status = TP_BUFFER_FILLED;
+    buf->filled[buf->tail] = slot;
+    buf->tail = (buf->tail + 1) % TP_BUFFER_NUM;
     buf->count++;
   }
+  _TP_BUFFER_UNLOCK();
 
-  if (slot)
+  if (released)
   {
-    slot = NULL;
+    osSemaphoreRelease(buf->released);
   }
 }
+
+void tp_buffer_ref(tp_buffer_slot_t *slot)
+{
+  _TP_BUFFER_LOCK();
+  slot->refs++;
+  _TP_BUFFER_UNLOCK();
+}
@@ -3,6 +3,17 @@
  *
  * @brief Multiple buffering for the TinyProbe
  *
+ * Buffers are reference counted, variable length regions of one contiguous ring (bip buffer).
+ * Regions are handed out in order at the write end and reclaimed in the same order at the read
+ * end, a region that does not fit before the end of the ring starts over at its beginning. Each
+ * region keeps @ref TP_BUFFER_HEADROOM bytes in front of the DMA landing zone, so protocol
+ * headers can be prepended in place, and @ref TP_BUFFER_TAILROOM bytes after it for trailers.
+ * Filled buffers are handed from the writer to the reader in order.
+ *
+ * References may be dropped in any order (e.g. by the retransmit cache). A released region is
+ * only reclaimed once all older regions are released as well. The ring starts over at its
+ * beginning whenever it runs empty, so no reset between shots is needed.
+ *
  * @author Cédric Hirschi, ETH Zürich
  * @date 08.04.2024
  *
@@ -13,6 +24,8 @@
 #ifndef TP_BUFFER_H_
 #define TP_BUFFER_H_
 
+#include "cmsis_os2.h"
+
 #include "common.h"
 
 /**
@@ -34,9 +47,12 @@ typedef enum
  */
 typedef struct
 {
-  uint8_t data[TP_BUFFER_SIZE]; /**< Buffer data */
-  size_t length;                /**< Length of the buffer data */
-  tp_buffer_status_t status;    /**< Status of the buffer @warning Do not modify */
+  uint8_t *data;             /**< Region in the ring (headroom, packet and tailroom) */
+  size_t size;               /**< Size of the region */
+  size_t offset;             /**< Offset of the packet in the region */
+  size_t length;             /**< Length of the packet */
+  volatile uint8_t refs;     /**< Reference count @warning Do not modify */
+  tp_buffer_status_t status; /**< Status of the buffer @warning Do not modify */
 } tp_buffer_slot_t;
 
 /**
@@ -47,10 +63,20 @@ typedef struct
  */
 typedef struct
 {
-  tp_buffer_slot_t slots[TP_BUFFER_NUM]; /**< Buffer slots */
-  size_t head;                           /**< Head index */
-  size_t tail;                           /**< Tail index */
-  size_t count;                          /**< Number of filled slots */
+  uint8_t ring[TP_BUFFER_RING_SIZE] __attribute__((aligned(TP_BUFFER_ALIGN))); /**< Region storage */
+  size_t write;                                /**< Ring offset of the next region */
+  size_t wrap;                                 /**< End of the used ring before the write end started over */
+  tp_buffer_slot_t slots[TP_BUFFER_NUM];       /**< Buffer slots (region descriptors) */
+  tp_buffer_slot_t *free_slots[TP_BUFFER_NUM]; /**< Stack of free slots */
+  size_t num_free;                             /**< Number of free slots */
+  tp_buffer_slot_t *regions[TP_BUFFER_NUM];    /**< Queue of slots holding a region, oldest first */
+  size_t regions_head;                         /**< Head index of the region queue */
+  size_t regions_count;                        /**< Number of slots holding a region */
+  tp_buffer_slot_t *filled[TP_BUFFER_NUM];     /**< Queue of filled slots */
+  size_t head;                                 /**< Head index of the filled queue */
+  size_t tail;                                 /**< Tail index of the filled queue */
+  size_t count;                                /**< Number of filled slots */
+  osSemaphoreId_t released;                    /**< Signals a reclaimed region */
 } tp_buffer_t;
 
 /**
@@ -58,35 +84,130 @@ typedef struct
  *
  * @param buf Buffer structure to initialize
  *
+ * @note All references are dropped, only call when no slot is in use
+ *
  */
 void tp_buffer_init(tp_buffer_t *buf);
 
 /**
  * @brief Claim a buffer slot for writing
  *
+ * The slot is empty with its packet starting after the headroom and holds one reference. Its
+ * region fits @p size bytes of packet plus headroom and tailroom and is @ref TP_BUFFER_ALIGN
+ * aligned. Waits up to @ref TP_BUFFER_TIMEOUT_MS for regions to be reclaimed if the ring is full.
+ *
  * @param buf Buffer structure to claim from
- * @return Pointer to the claimed buffer slot
+ * @param size Packet size to reserve (without headroom and tailroom)
+ * @return Pointer to the claimed buffer slot, NULL on timeout
  *
  */
-tp_buffer_slot_t *tp_buffer_claim_writing(tp_buffer_t *buf);
+tp_buffer_slot_t *tp_buffer_claim_writing(tp_buffer_t *buf, size_t size);
 
 /**
- * @brief Return a buffer slot after writing
+ * @brief Claim the oldest filled buffer slot for reading
  *
- * @param buf Buffer structure to return to
- * @param slot Pointer to the buffer slot to return
+ * @param buf Buffer structure to claim from
+ * @return Pointer to the claimed buffer slot, NULL if no slot is filled
  *
  */
 tp_buffer_slot_t *tp_buffer_claim_reading(tp_buffer_t *buf);
 
 /**
- * @brief Return a buffer slot after reading
+ * @brief Return a buffer slot after writing or reading
  *
  * @param buf Buffer structure to return to
  * @param slot Pointer to the buffer slot to return
- * @param discard Discard the buffer slot after reading
+ * @param discard Drop a reference instead of queueing the slot for reading, the slot is
+ *                released to the pool once no reference is left
+ *
+ * @note Discarding may happen from another thread or an interrupt (e.g. a transmit completion)
  *
  */
 void tp_buffer_return(tp_buffer_t *buf, tp_buffer_slot_t *slot, bool discard);
 
+/**
+ * @brief Take an additional reference to a buffer slot
+ *
+ * @param slot Pointer to the buffer slot
+ *
+ * @note Every reference must be dropped with @ref tp_buffer_return (discard)
+ *
+ */
+void tp_buffer_ref(tp_buffer_slot_t *slot);
+
+/**
+ * @brief Get the start of the packet in a buffer slot
+ *
+ * @param slot Pointer to the buffer slot
+ * @return Pointer to the first packet byte
+ *
+ */
+static inline uint8_t *tp_buffer_packet(tp_buffer_slot_t *slot)
+{
+  return slot->data + slot->offset;
+}
+
+/**
+ * @brief Extend the packet at its end
+ *
+ * @param slot Pointer to the buffer slot
+ * @param length Number of bytes to append
+ * @return Pointer to the appended bytes, NULL if the buffer is too small
+ *
+ */
+static inline uint8_t *tp_buffer_put(tp_buffer_slot_t *slot, size_t length)
+{
+  if (slot->offset + slot->length + length > slot->size)
+  {
+    return NULL;
+  }
+
+  uint8_t *end = slot->data + slot->offset + slot->length;
+  slot->length += length;
+
+  return end;
+}
+
+/**
+ * @brief Extend the packet at its start into the headroom
+ *
+ * @param slot Pointer to the buffer slot
+ * @param length Number of bytes to prepend
+ * @return Pointer to the new start of the packet, NULL if the headroom is too small
+ *
+ */
+static inline uint8_t *tp_buffer_push(tp_buffer_slot_t *slot, size_t length)
+{
+  if (length > slot->offset)
+  {
+    return NULL;
+  }
+
+  slot->offset -= length;
+  slot->length += length;
+
+  return slot->data + slot->offset;
+}
+
+/**
+ * @brief Remove bytes from the start of the packet
+ *
+ * @param slot Pointer to the buffer slot
+ * @param length Number of bytes to remove
+ * @return Pointer to the new start of the packet, NULL if the packet is too short
+ *
+ */
+static inline uint8_t *tp_buffer_pull(tp_buffer_slot_t *slot, size_t length)
+{
+  if (length > slot->length)
+  {
+    return NULL;
+  }
+
+  slot->offset += length;
+  slot->length -= length;
+
+  return slot->data + slot->offset;
+}
+
 #endif /* TP_BUFFER_H_ */
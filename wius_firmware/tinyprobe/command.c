@@ -13,71 +13,342 @@
 #include "command.h"
 
 #include "tinyprobe/tp.h"
+#include "tinyprobe/program.h"
+#include "tinyprobe/profile.h"
+#include "tinyprobe/retx.h"
+
+#if TP_COMMAND_IMMEDIATE_ARGS < 7
+#error "TP_COMMAND_IMMEDIATE_ARGS too small for the SUBSCRIBE arguments"
+#endif
 
 tp_command_t _tp_command_commands[TP_COMMAND_MAX];
 uint16_t _tp_num_commands = 0;
 
+// Storage for the arguments of commands expanded from the compact encoding
+uint8_t _tp_command_arena[TP_COMMAND_ARENA_SIZE];
+
 // Command packet minimum lengths
-uint8_t _tp_command_min_lengths[TP_CMD_ID_MAX] = {0, 1, 1, 1, 5, 4, 6, 8, 4, 2, 6};
+uint8_t _tp_command_min_lengths[TP_CMD_ID_MAX] = {0, 1, 1, 1, 5, 4, 6, 8, 4, 2, 6, 7, 3, 2, 0, 4, 6, 4, 3, 5, 4, 5, 6, 3, 7, 1, 1};
 
-tp_command_t *tp_command_parse(uint8_t *buffer, size_t buffer_length)
-{
-    (void)buffer_length;
+// Commands executed directly on the control thread
+bool _tp_command_immediate[TP_CMD_ID_MAX] = {
+    [TP_CMD_PING] = true,
+    [TP_CMD_GET_STATS] = true,
+    [TP_CMD_NACK] = true,
+    [TP_CMD_PACING] = true,
+    [TP_CMD_CREDIT] = true,
+    [TP_CMD_SUBSCRIBE] = true,
+    [TP_CMD_LINK] = true,
+};
 
-    // clear the commands
-    memset(_tp_command_commands, 0, sizeof(_tp_command_commands));
-    _tp_num_commands = 0;
+// Separate storage, immediate batches are decoded while the main thread executes
+// Batches with longer arguments (e.g. a larger NACK bitmap) do not fit and go to the main thread
+tp_command_t _tp_command_immediate_commands[TP_COMMAND_IMMEDIATE_MAX];
+uint8_t _tp_command_immediate_arena[TP_COMMAND_IMMEDIATE_ARENA_SIZE];
 
+sl_status_t _tp_command_decode_v1(uint8_t *buffer, size_t buffer_length, tp_command_t *commands,
+                                  uint16_t max_commands, uint16_t *num_commands)
+{
     // get number of commands (byte 0,1)
-    uint16_t num_commands = *((uint16_t *)&buffer[0]);
+    uint16_t count = *((uint16_t *)&buffer[0]);
 
-    if (num_commands > TP_COMMAND_MAX || num_commands == 0)
+    if (count > max_commands || count == 0)
     {
-        LOG_W("%u is invalid amount of commands (0 - %u)", 0, TP_COMMAND_MAX);
-        return NULL;
+        LOG_W("%u is invalid amount of commands (1 - %u)", count, max_commands);
+        return SL_STATUS_INVALID_PARAMETER;
     }
 
     // index of the first command
-    uint16_t index = 2;
+    size_t index = 2;
 
     // iterate over the commands
-    for (uint16_t i = 0; i < num_commands; i++)
+    for (uint16_t i = 0; i < count; i++)
     {
+        if (index + 3 > buffer_length)
+        {
+            LOG_W("Command %u exceeds the buffer", i);
+            return SL_STATUS_INVALID_PARAMETER;
+        }
+
         // get the command id (offset byte 0)
-        tp_command_id_t id = buffer[index];
+        commands[i].id = buffer[index];
         index++;
 
+        // get the command arguments length (offset byte 1,2)
+        commands[i].args_length = *((uint16_t *)&buffer[index]);
+        index += 2;
+
+        // get the command arguments
+        commands[i].args = &buffer[index];
+        index += commands[i].args_length;
+
+        if (index > buffer_length)
+        {
+            LOG_W("Command %u exceeds the buffer", i);
+            return SL_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    *num_commands = count;
+
+    return SL_STATUS_OK;
+}
+
+bool _tp_command_read_varint(const uint8_t *buffer, size_t buffer_length, size_t *index, uint32_t *value)
+{
+    *value = 0;
+
+    for (uint8_t shift = 0; shift < 35; shift += 7)
+    {
+        if (*index >= buffer_length)
+        {
+            return false;
+        }
+
+        uint8_t byte = buffer[(*index)++];
+
+        // the 5th byte only holds the top 4 bits of the value
+        if (28 == shift && (byte & 0xF0))
+        {
+            return false;
+        }
+
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+sl_status_t _tp_command_decode_v2(uint8_t *buffer, size_t buffer_length, tp_command_t *commands,
+                                  uint16_t max_commands, uint16_t *num_commands,
+                                  uint8_t *arena, size_t arena_size)
+{
+    // header is [0x00 0x00 version], records start after it
+    size_t index = 3;
+    size_t arena_used = 0;
+    uint16_t count = 0;
+    uint32_t num_records = 0;
+
+    if (!_tp_command_read_varint(buffer, buffer_length, &index, &num_records) || num_records == 0)
+    {
+        LOG_W("Invalid amount of records");
+        return SL_STATUS_INVALID_PARAMETER;
+    }
+
+    for (uint32_t r = 0; r < num_records; r++)
+    {
+        if (index >= buffer_length)
+        {
+            LOG_W("Record %lu exceeds the buffer", r);
+            return SL_STATUS_INVALID_PARAMETER;
+        }
+
+        tp_command_id_t id = buffer[index++];
+        uint32_t entries = 1;
+        uint8_t dtgc_reg_flag = 0;
+        int32_t reg_addr = -1;
+
+        switch (id)
+        {
+        case TP_CMD_WRITE_AFE:
+            if (index >= buffer_length)
+            {
+                return SL_STATUS_INVALID_PARAMETER;
+            }
+            dtgc_reg_flag = buffer[index++];
+            /* fall through */
+        case TP_CMD_WRITE_FPGA:
+        case TP_CMD_WRITE_TX:
+            if (!_tp_command_read_varint(buffer, buffer_length, &index, &entries))
+            {
+                return SL_STATUS_INVALID_PARAMETER;
+            }
+            break;
+        default:
+            break;
+        }
+
+        for (uint32_t e = 0; e < entries; e++)
+        {
+            if (count >= max_commands)
+            {
+                LOG_W("More than %u commands", max_commands);
+                return SL_STATUS_INVALID_PARAMETER;
+            }
+
+            tp_command_t *command = &commands[count++];
+            uint8_t *args = &arena[arena_used];
+            size_t length = 0;
+            uint32_t delta = 0;
+            uint32_t value = 0;
+
+            switch (id)
+            {
+            case TP_CMD_WRITE_FPGA:
+            case TP_CMD_WRITE_AFE:
+            case TP_CMD_WRITE_TX:
+                // address delta is zigzag coded relative to the previous address + 1
+                if (!_tp_command_read_varint(buffer, buffer_length, &index, &delta) ||
+                    !_tp_command_read_varint(buffer, buffer_length, &index, &value))
+                {
+                    return SL_STATUS_INVALID_PARAMETER;
+                }
+                reg_addr += 1 + (int32_t)((delta >> 1) ^ -(delta & 1));
+                length = (id == TP_CMD_WRITE_FPGA) ? 5 : (id == TP_CMD_WRITE_AFE) ? 4 : 6;
+                break;
+            case TP_CMD_DELAY_NS:
+            case TP_CMD_SLEEP_MS:
+                if (!_tp_command_read_varint(buffer, buffer_length, &index, &value))
+                {
+                    return SL_STATUS_INVALID_PARAMETER;
+                }
+                length = _tp_command_min_lengths[id];
+                break;
+            default:
+                // compare without adding, a large length must not wrap the sum
+                if (!_tp_command_read_varint(buffer, buffer_length, &index, &value) ||
+                    value > UINT16_MAX || value > buffer_length - index)
+                {
+                    return SL_STATUS_INVALID_PARAMETER;
+                }
+                length = value;
+                break;
+            }
+
+            if (length > arena_size - arena_used)
+            {
+                LOG_W("Expanded arguments exceed %u bytes", arena_size);
+                return SL_STATUS_WOULD_OVERFLOW;
+            }
+
+            // expand into the fixed width arguments the handlers expect
+            switch (id)
+            {
+            case TP_CMD_WRITE_FPGA:
+                args[0] = reg_addr;
+                memcpy(&args[1], &value, 4);
+                break;
+            case TP_CMD_WRITE_AFE:
+                args[0] = dtgc_reg_flag;
+                args[1] = reg_addr;
+                memcpy(&args[2], &value, 2);
+                break;
+            case TP_CMD_WRITE_TX:
+                memcpy(&args[0], &reg_addr, 2);
+                memcpy(&args[2], &value, 4);
+                break;
+            case TP_CMD_DELAY_NS:
+            case TP_CMD_SLEEP_MS:
+                memset(args, 0, length);
+                memcpy(&args[0], &value, 4);
+                break;
+            default:
+                memcpy(args, &buffer[index], length);
+                index += length;
+                break;
+            }
+
+            command->id = id;
+            command->args = args;
+            command->args_length = length;
+            arena_used += length;
+        }
+    }
+
+    *num_commands = count;
+
+    return SL_STATUS_OK;
+}
+
+sl_status_t tp_command_decode(uint8_t *buffer, size_t buffer_length, tp_command_t *commands,
+                              uint16_t max_commands, uint16_t *num_commands,
+                              uint8_t *arena, size_t arena_size)
+{
+    sl_status_t status = SL_STATUS_OK;
+    uint16_t count = 0;
+
+    *num_commands = 0;
+
+    if (buffer_length < 3)
+    {
+        LOG_W("Command batch too short");
+        return SL_STATUS_INVALID_PARAMETER;
+    }
+
+    // a zero command count (invalid in the original encoding) is followed by a version byte
+    if (buffer[0] == 0 && buffer[1] == 0)
+    {
+        if (buffer[2] != TP_COMMAND_VERSION_COMPACT)
+        {
+            LOG_W("Unsupported command encoding %u", buffer[2]);
+            return SL_STATUS_INVALID_PARAMETER;
+        }
+
+        CHECK_STATUS(_tp_command_decode_v2(buffer, buffer_length, commands, max_commands, &count,
+                                           arena, arena_size));
+    }
+    else
+    {
+        CHECK_STATUS(_tp_command_decode_v1(buffer, buffer_length, commands, max_commands, &count));
+    }
+
+    // nesting depth of LOOP / END blocks
+    uint8_t depth = 0;
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        tp_command_id_t id = commands[i].id;
+
         if (id >= TP_CMD_ID_MAX)
         {
             LOG_W("%u is invalid, max. valid is %u", id, TP_CMD_ID_MAX);
-            return NULL;
+            return SL_STATUS_INVALID_PARAMETER;
         }
 
-        // get the command arguments length (offset byte 1,2)
-        uint16_t length = *((uint16_t *)&buffer[index]);
-        index += 2;
+        if (commands[i].args_length < _tp_command_min_lengths[id])
+        {
+            LOG_W("Command %u has invalid arguments length %u", id, commands[i].args_length);
+            return SL_STATUS_INVALID_PARAMETER;
+        }
 
-        // get the command arguments
-        uint8_t *args = &buffer[index];
-        index += length;
+        if (id == TP_CMD_LOOP && ++depth > TP_COMMAND_LOOP_DEPTH)
+        {
+            LOG_W("Loops nested deeper than %u", TP_COMMAND_LOOP_DEPTH);
+            return SL_STATUS_INVALID_PARAMETER;
+        }
+        if (id == TP_CMD_END && depth-- == 0)
+        {
+            LOG_W("END without LOOP");
+            return SL_STATUS_INVALID_PARAMETER;
+        }
+    }
 
-        // create the command
-        tp_command_t command = {
-            .id = id,
-            .args_length = length,
-            .args = args};
+    if (depth != 0)
+    {
+        LOG_W("%u LOOP without END", depth);
+        return SL_STATUS_INVALID_PARAMETER;
+    }
 
-//        LOG_D("  %u: %u", id, length);
-//        for (uint8_t j = 0; j < length; j++)
-//        {
-//          LOG_D("    %u", args[j]);
-//        }
+    *num_commands = count;
 
-        // store the command
-        _tp_command_commands[i] = command;
+    return status;
+}
 
-        // increment the number of commands
-        _tp_num_commands++;
+tp_command_t *tp_command_parse(uint8_t *buffer, size_t buffer_length)
+{
+    // clear the commands
+    memset(_tp_command_commands, 0, sizeof(_tp_command_commands));
+    _tp_num_commands = 0;
+
+    if (SL_STATUS_OK != tp_command_decode(buffer, buffer_length, _tp_command_commands, TP_COMMAND_MAX,
+                                          &_tp_num_commands, _tp_command_arena, sizeof(_tp_command_arena)))
+    {
+        return NULL;
     }
 
     return _tp_command_commands;
@@ -92,57 +363,232 @@ sl_status_t tp_command_execute(tp_command_t command)
 
     // LOG_D("Executing command with ID %d", command.id);
 
+    sl_status_t status = SL_STATUS_OK;
+    uint32_t start = tp_profile_start();
+    uint32_t logged = log_cycles;
+
     switch (command.id)
     {
     case TP_CMD_PING:
-        tp_ping(command.args, command.args_length);
+        status = tp_ping(command.args, command.args_length);
         break;
     case TP_CMD_EN_REPLIES:
-        tp_en_replies(command.args, command.args_length);
+        status = tp_en_replies(command.args, command.args_length);
         break;
     case TP_CMD_SW_MUX:
-        tp_sw_mux(command.args, command.args_length);
+        status = tp_sw_mux(command.args, command.args_length);
         break;
     case TP_CMD_WRITE_SPI:
-        tp_write_spi(command.args, command.args_length);
+        status = tp_write_spi(command.args, command.args_length);
         break;
     case TP_CMD_WRITE_FPGA:
-        tp_write_fpga(command.args, command.args_length);
+        status = tp_write_fpga(command.args, command.args_length);
         break;
     case TP_CMD_WRITE_AFE:
-        tp_write_afe(command.args, command.args_length);
+        status = tp_write_afe(command.args, command.args_length);
         break;
     case TP_CMD_WRITE_TX:
-        tp_write_tx(command.args, command.args_length);
+        status = tp_write_tx(command.args, command.args_length);
         break;
     case TP_CMD_DELAY_NS:
-        tp_delay_ns(command.args, command.args_length);
+        status = tp_delay_ns(command.args, command.args_length);
         break;
     case TP_CMD_SLEEP_MS:
-        tp_sleep_ms(command.args, command.args_length);
+        status = tp_sleep_ms(command.args, command.args_length);
         break;
     case TP_CMD_CTRL_PWR:
-        tp_ctrl_pwr(command.args, command.args_length);
+        status = tp_ctrl_pwr(command.args, command.args_length);
         break;
     case TP_CMD_TRIGGER_SHOT:
-        tp_trigger_shot(command.args, command.args_length);
+        status = tp_trigger_shot(command.args, command.args_length);
+        break;
+    case TP_CMD_PROG_STORE:
+        status = tp_program_store(command.args, command.args_length);
+        break;
+    case TP_CMD_PROG_RUN:
+        status = tp_program_run(command.args, command.args_length);
+        break;
+    case TP_CMD_WAIT_FPGA_IRQ:
+        status = tp_wait_fpga_irq(command.args, command.args_length);
+        break;
+    case TP_CMD_SET_PARAM:
+        status = tp_set_param(command.args, command.args_length);
+        break;
+    case TP_CMD_WRITE_PARAM:
+        status = tp_write_param(command.args, command.args_length);
+        break;
+    case TP_CMD_GET_STATS:
+        status = tp_get_stats(command.args, command.args_length);
+        break;
+    case TP_CMD_NACK:
+        status = tp_retx_nack(command.args, command.args_length);
+        break;
+    case TP_CMD_SET_FEC:
+        status = tp_set_fec(command.args, command.args_length);
+        break;
+    case TP_CMD_PACING:
+        status = tp_pacing(command.args, command.args_length);
+        break;
+    case TP_CMD_CREDIT:
+        status = tp_credit(command.args, command.args_length);
         break;
+    case TP_CMD_SUBSCRIBE:
+        status = tp_subscribe(command.args, command.args_length);
+        break;
+    case TP_CMD_TWT:
+        status = tp_twt(command.args, command.args_length);
+        break;
+    case TP_CMD_LINK:
+        status = tp_link(command.args, command.args_length);
+        break;
+    case TP_CMD_STANDBY:
+        status = tp_standby(command.args, command.args_length);
+        break;
+    case TP_CMD_LOOP:
+    case TP_CMD_END:
+        LOG_W("Loop outside of a command list");
+        return SL_STATUS_INVALID_PARAMETER;
     default:
         LOG_W("Unknown command");
         return SL_STATUS_INVALID_PARAMETER;
     }
-    return SL_STATUS_OK;
+
+    // Leave out the time the handler spent printing log messages
+    tp_profile_record(command.id, start + (log_cycles - logged));
+
+    return status;
 }
 
-sl_status_t tp_command_parse_and_execute(uint8_t *buffer, size_t buffer_length)
+sl_status_t tp_command_execute_list(const tp_command_t *commands, uint16_t num_commands, uint32_t start_time)
 {
     sl_status_t status = SL_STATUS_OK;
-    tp_command_t *commands = tp_command_parse(buffer, buffer_length);
 
-    for (uint16_t i = 0; i < _tp_num_commands; i++)
+    // open loops, innermost last
+    struct
+    {
+        uint16_t start;     // index of the LOOP command
+        uint16_t remaining; // iterations left including the current one
+    } loops[TP_COMMAND_LOOP_DEPTH];
+    uint8_t depth = 0;
+
+    for (uint16_t i = 0; i < num_commands; i++)
     {
-        CHECK_STATUS(tp_command_execute(commands[i]));
+        if (TP_COMMAND_MAX_EXEC_MS && time_ms() - start_time > TP_COMMAND_MAX_EXEC_MS)
+        {
+            LOG_W("Execution time exceeded %u ms, aborting", TP_COMMAND_MAX_EXEC_MS);
+            return SL_STATUS_TIMEOUT;
+        }
+
+        switch (commands[i].id)
+        {
+        case TP_CMD_LOOP:
+        {
+            uint16_t iterations = *(uint16_t *)commands[i].args;
+
+            if (iterations == 0)
+            {
+                // skip to the matching END
+                uint8_t nested = 0;
+                for (i++; i < num_commands; i++)
+                {
+                    if (commands[i].id == TP_CMD_LOOP)
+                        nested++;
+                    else if (commands[i].id == TP_CMD_END && nested-- == 0)
+                        break;
+                }
+                break;
+            }
+
+            if (depth >= TP_COMMAND_LOOP_DEPTH)
+            {
+                return SL_STATUS_INVALID_PARAMETER;
+            }
+
+            loops[depth].start = i;
+            loops[depth].remaining = iterations;
+            depth++;
+            break;
+        }
+        case TP_CMD_END:
+            if (depth == 0)
+            {
+                return SL_STATUS_INVALID_PARAMETER;
+            }
+
+            if (--loops[depth - 1].remaining > 0)
+            {
+                i = loops[depth - 1].start;
+            }
+            else
+            {
+                depth--;
+            }
+            break;
+        default:
+            CHECK_STATUS(tp_command_execute(commands[i]));
+            break;
+        }
     }
 
     return SL_STATUS_OK;
 }
+
+sl_status_t tp_command_execute_immediate(uint8_t *buffer, size_t buffer_length, bool *executed)
+{
+    sl_status_t status = SL_STATUS_OK;
+    uint16_t num_commands = 0;
+    uint32_t count = 0;
+
+    *executed = false;
+
+    // only small batches qualify, peek at the count to not decode (and warn about) large ones
+    if (buffer_length < 3)
+        return SL_STATUS_OK;
+    if (buffer[0] == 0 && buffer[1] == 0)
+    {
+        size_t index = 3;
+        if (buffer[2] != TP_COMMAND_VERSION_COMPACT || !_tp_command_read_varint(buffer, buffer_length, &index, &count))
+            return SL_STATUS_OK;
+    }
+    else
+    {
+        count = *((uint16_t *)&buffer[0]);
+    }
+    if (count > TP_COMMAND_IMMEDIATE_MAX)
+        return SL_STATUS_OK;
+
+    if (SL_STATUS_OK != tp_command_decode(buffer, buffer_length, _tp_command_immediate_commands,
+                                          TP_COMMAND_IMMEDIATE_MAX, &num_commands, _tp_command_immediate_arena,
+                                          sizeof(_tp_command_immediate_arena)))
+    {
+        return SL_STATUS_OK;
+    }
+
+    for (uint16_t i = 0; i < num_commands; i++)
+    {
+        if (!_tp_command_immediate[_tp_command_immediate_commands[i].id])
+            return SL_STATUS_OK;
+    }
+
+    *executed = true;
+
+    for (uint16_t i = 0; i < num_commands; i++)
+    {
+        sl_status_t command_status = tp_command_execute(_tp_command_immediate_commands[i]);
+        if (SL_STATUS_OK == status)
+            status = command_status;
+    }
+
+    return status;
+}
+
+sl_status_t tp_command_parse_and_execute(uint8_t *buffer, size_t buffer_length)
+{
+    tp_command_t *commands = tp_command_parse(buffer, buffer_length);
+    if (NULL == commands)
+    {
+        return SL_STATUS_INVALID_PARAMETER;
+    }
+
+    return tp_command_execute_list(commands, _tp_num_commands, time_ms());
+}
@@ -15,6 +15,8 @@
 
 #include "common.h"
 
+#define TP_COMMAND_VERSION_COMPACT 2 /**< Version byte of the compact command encoding */
+
 /**
  * @brief Command IDs enumeration
  *
@@ -32,6 +34,22 @@ typedef enum tp_cmd_id
 	TP_CMD_SLEEP_MS,
 	TP_CMD_CTRL_PWR,
 	TP_CMD_TRIGGER_SHOT,
+	TP_CMD_PROG_STORE,
+	TP_CMD_PROG_RUN,
+	TP_CMD_LOOP,
+	TP_CMD_END,
+	TP_CMD_WAIT_FPGA_IRQ,
+	TP_CMD_SET_PARAM,
+	TP_CMD_WRITE_PARAM,
+	TP_CMD_GET_STATS,
+	TP_CMD_NACK,
+	TP_CMD_SET_FEC,
+	TP_CMD_PACING,
+	TP_CMD_CREDIT,
+	TP_CMD_SUBSCRIBE,
+	TP_CMD_TWT,
+	TP_CMD_LINK,
+	TP_CMD_STANDBY,
 	TP_CMD_ID_MAX
 } tp_command_id_t;
 
@@ -71,6 +89,46 @@ typedef struct tp_cmd
 	size_t args_length;
 } tp_command_t;
 
+/**
+ * @brief Decode a command batch into a command array
+ *
+ * The batch has the same layout as a command packet (see @ref tp_command_t). Every command is
+ * checked against the buffer bounds, the valid IDs, the minimum argument length and the loop
+ * nesting rules.
+ *
+ * A batch starting with a zero command count is followed by a version byte. Version
+ * @ref TP_COMMAND_VERSION_COMPACT selects the compact encoding, where all integers are unsigned
+ * LEB128 varints:
+ *
+ * - Header: <tt>0x00 0x00 0x02</tt>, number of records
+ * - WRITE_FPGA, WRITE_TX: ID, number of writes, then per write the zigzag coded address delta
+ *   to the previous address + 1 (0 for consecutive addresses, the first write is relative to -1)
+ *   and the value
+ * - WRITE_AFE: ID, DTGC flag (one byte), then the same as WRITE_FPGA
+ * - DELAY_NS, SLEEP_MS: ID, value
+ * - All other commands: ID, arguments length, arguments as in the original encoding
+ *
+ * Compact records are expanded into the fixed width arguments the handlers expect.
+ *
+ * @param buffer The buffer containing the command batch
+ * @param buffer_length The length of the buffer
+ * @param commands The array to store the decoded commands in
+ * @param max_commands The size of the commands array
+ * @param num_commands Pointer to store the number of decoded commands
+ * @param arena Storage for arguments expanded from the compact encoding
+ * @param arena_size Size of the arena in bytes
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_INVALID_PARAMETER: The batch is malformed or its loops are unbalanced
+ * @retval SL_STATUS_WOULD_OVERFLOW: Expanded arguments do not fit into the arena
+ *
+ * @note The arguments of the decoded commands point into @p buffer or @p arena
+ *
+ */
+sl_status_t tp_command_decode(uint8_t *buffer, size_t buffer_length, tp_command_t *commands,
+                              uint16_t max_commands, uint16_t *num_commands,
+                              uint8_t *arena, size_t arena_size);
+
 /**
  * @brief Parse a command from a buffer
  *
@@ -92,6 +150,41 @@ tp_command_t *tp_command_parse(uint8_t *buffer, size_t buffer_length);
  */
 sl_status_t tp_command_execute(tp_command_t command);
 
+/**
+ * @brief Execute a list of decoded commands in order
+ *
+ * LOOP (argument: iteration count [uint16_t]) repeats the commands up to its matching END. Loops
+ * nest up to @ref TP_COMMAND_LOOP_DEPTH levels and the whole list is aborted once it ran for
+ * longer than @ref TP_COMMAND_MAX_EXEC_MS since @p start_time.
+ *
+ * @param commands The commands to execute
+ * @param num_commands The number of commands
+ * @param start_time Start of the execution budget in ms (@ref time_ms), shared by repeated lists
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_TIMEOUT: Execution time limit exceeded
+ * @retval other: Status of the first failing command execution
+ *
+ */
+sl_status_t tp_command_execute_list(const tp_command_t *commands, uint16_t num_commands, uint32_t start_time);
+
+/**
+ * @brief Execute a batch directly if it only holds immediate commands
+ *
+ * Immediate commands (PING, GET_STATS, NACK, PACING, CREDIT, SUBSCRIBE, LINK) are short and safe to
+ * run while the main thread executes another batch, so they are not queued behind a running acquisition.
+ *
+ * @param buffer The buffer containing the batch
+ * @param buffer_length The length of the buffer
+ * @param executed Pointer to store whether the batch was executed
+ *
+ * @return The status of the first failing command execution
+ *
+ * @note Batches that are not executed must be handed to @ref tp_command_parse_and_execute
+ *
+ */
+sl_status_t tp_command_execute_immediate(uint8_t *buffer, size_t buffer_length, bool *executed);
+
 /**
  * @brief Parse and execute a command from a buffer
  *
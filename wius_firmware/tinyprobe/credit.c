@@ -0,0 +1,118 @@
+/**
+ * @file credit.c
+ *
+ * @brief Host-granted credit flow control implementation for the TinyProbe data stream
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "credit.h"
+
+#include "cmsis_os2.h"
+#include "si91x_device.h"
+
+tp_credit_mode_t _tp_credit_mode = TP_CREDIT_PUSH;
+tp_credit_unit_t _tp_credit_unit = TP_CREDIT_UNIT_DATAGRAMS;
+volatile uint32_t _tp_credit = 0;
+uint32_t _tp_credit_sent = 0;
+uint32_t _tp_credit_dropped = 0;
+
+void tp_credit_init(void)
+{
+  tp_credit_config(TP_CREDIT_MODE, TP_CREDIT_UNIT);
+}
+
+sl_status_t tp_credit_config(tp_credit_mode_t mode, tp_credit_unit_t unit)
+{
+  if (mode >= TP_CREDIT_MODE_MAX || unit >= TP_CREDIT_UNIT_MAX)
+  {
+    LOG_W("Invalid flow control mode %u / unit %u", mode, unit);
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  _tp_credit_mode = mode;
+  _tp_credit_unit = unit;
+  _tp_credit = 0;
+
+  return SL_STATUS_OK;
+}
+
+void tp_credit_grant(uint32_t amount)
+{
+  // Grants arrive on the control path while the data path may be taking credit
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  _tp_credit = (UINT32_MAX - _tp_credit < amount) ? UINT32_MAX : _tp_credit + amount;
+
+  __set_PRIMASK(primask);
+
+  osEventFlagsSet(event_flags, FLAG_CREDIT_GRANTED);
+}
+
+bool _tp_credit_try_take(uint32_t cost)
+{
+  bool taken = false;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  if (_tp_credit >= cost)
+  {
+    _tp_credit -= cost;
+    taken = true;
+  }
+
+  __set_PRIMASK(primask);
+
+  return taken;
+}
+
+bool tp_credit_take(uint32_t datagrams, uint32_t bytes)
+{
+  if (TP_CREDIT_PUSH == _tp_credit_mode)
+  {
+    return true;
+  }
+
+  uint32_t cost = (TP_CREDIT_UNIT_BYTES == _tp_credit_unit) ? bytes : datagrams;
+
+  osEventFlagsClear(event_flags, FLAG_CREDIT_GRANTED);
+  bool taken = _tp_credit_try_take(cost);
+
+  if (!taken && TP_CREDIT_PULL_BUFFER == _tp_credit_mode)
+  {
+    uint32_t start = time_ms();
+    uint32_t elapsed = 0;
+
+    // The shot stays in the FPGA FIFO while waiting for grants
+    while (!taken && elapsed < TP_CREDIT_WAIT_MS)
+    {
+      uint32_t timeout_ticks = ((TP_CREDIT_WAIT_MS - elapsed) * TICKS_PER_SEC + 999) / 1000;
+      osEventFlagsWait(event_flags, FLAG_CREDIT_GRANTED, osFlagsWaitAny, timeout_ticks);
+
+      taken = _tp_credit_try_take(cost);
+      elapsed = time_ms() - start;
+    }
+  }
+
+  if (taken)
+    _tp_credit_sent++;
+  else
+    _tp_credit_dropped++;
+
+  return taken;
+}
+
+void tp_credit_get(tp_credit_stats_t *stats)
+{
+  stats->mode = _tp_credit_mode;
+  stats->unit = _tp_credit_unit;
+  stats->credit = _tp_credit;
+  stats->sent = _tp_credit_sent;
+  stats->dropped = _tp_credit_dropped;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file credit.h
+ *
+ * @brief Host-granted credit flow control for the TinyProbe data stream
+ *
+ * In pull mode the host grants credit (datagrams or bytes) with CREDIT commands and a shot is
+ * only sent if the outstanding credit covers all of its packets. The credit of a shot is taken
+ * as a whole before it is read out, so shots are either sent completely or dropped completely.
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_CREDIT_H_
+#define TP_CREDIT_H_
+
+#include "common.h"
+
+/**
+ * @brief Flow control modes enumeration
+ *
+ */
+typedef enum tp_credit_mode
+{
+  TP_CREDIT_PUSH = 0,    /**< No flow control, shots are always sent */
+  TP_CREDIT_PULL_DROP,   /**< Shots without enough credit are dropped */
+  TP_CREDIT_PULL_BUFFER, /**< Shots wait in the FPGA FIFO for credit, dropped after a timeout */
+  TP_CREDIT_MODE_MAX     /**< Number of modes */
+} tp_credit_mode_t;
+
+/**
+ * @brief Credit units enumeration
+ *
+ */
+typedef enum tp_credit_unit
+{
+  TP_CREDIT_UNIT_DATAGRAMS = 0, /**< Credit counts datagrams */
+  TP_CREDIT_UNIT_BYTES,         /**< Credit counts bytes */
+  TP_CREDIT_UNIT_MAX            /**< Number of units */
+} tp_credit_unit_t;
+
+/**
+ * @brief Flow control status (as replied to the CREDIT command)
+ *
+ */
+typedef struct __attribute__((packed)) tp_credit_stats
+{
+  uint8_t mode;     /**< Flow control mode (@ref tp_credit_mode_t) */
+  uint8_t unit;     /**< Credit unit (@ref tp_credit_unit_t) */
+  uint32_t credit;  /**< Outstanding credit */
+  uint32_t sent;    /**< Number of shots sent in pull mode */
+  uint32_t dropped; /**< Number of shots dropped for lack of credit */
+} tp_credit_stats_t;
+
+/**
+ * @brief Initialize flow control (push mode, no credit)
+ *
+ */
+void tp_credit_init(void);
+
+/**
+ * @brief Configure flow control
+ *
+ * @param mode: Flow control mode
+ * @param unit: Credit unit
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_INVALID_PARAMETER: Unknown mode or unit
+ *
+ * @note Outstanding credit is discarded
+ *
+ */
+sl_status_t tp_credit_config(tp_credit_mode_t mode, tp_credit_unit_t unit);
+
+/**
+ * @brief Add host-granted credit
+ *
+ * @param amount: Credit in the configured unit
+ *
+ */
+void tp_credit_grant(uint32_t amount);
+
+/**
+ * @brief Take the credit for a whole shot
+ *
+ * In @ref TP_CREDIT_PULL_BUFFER mode waits up to @ref TP_CREDIT_WAIT_MS for grants.
+ *
+ * @param datagrams: Number of datagrams of the shot
+ * @param bytes: Number of bytes of the shot
+ *
+ * @return Whether the shot may be sent (false: drop the whole shot)
+ *
+ */
+bool tp_credit_take(uint32_t datagrams, uint32_t bytes);
+
+/**
+ * @brief Get the flow control status
+ *
+ * @param stats: Pointer to store the status
+ *
+ */
+void tp_credit_get(tp_credit_stats_t *stats);
+
+#endif /* TP_CREDIT_H_ */
@@ -0,0 +1,115 @@
+/**
+ * @file fec.c
+ *
+ * @brief Forward error correction implementation for the TinyProbe data stream
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "fec.h"
+
+#define TP_FEC_GF_POLY 0x11D // GF(2^8) reduction polynomial
+
+// GF(2^8) exponent (doubled to skip the modulo) and logarithm tables
+uint8_t _tp_fec_exp[512];
+uint8_t _tp_fec_log[256];
+
+uint8_t _tp_fec_mul(uint8_t a, uint8_t b)
+{
+  if (0 == a || 0 == b)
+    return 0;
+
+  return _tp_fec_exp[_tp_fec_log[a] + _tp_fec_log[b]];
+}
+
+uint8_t _tp_fec_inv(uint8_t a)
+{
+  return _tp_fec_exp[255 - _tp_fec_log[a]];
+}
+
+void tp_fec_init(tp_fec_t *fec)
+{
+  uint16_t x = 1;
+  for (uint16_t i = 0; i < 255; i++)
+  {
+    _tp_fec_exp[i] = x;
+    _tp_fec_exp[i + 255] = x;
+    _tp_fec_log[x] = i;
+
+    x <<= 1;
+    if (x & 0x100)
+      x ^= TP_FEC_GF_POLY;
+  }
+  _tp_fec_exp[510] = _tp_fec_exp[0];
+  _tp_fec_exp[511] = _tp_fec_exp[1];
+
+  fec->k = 1;
+  fec->m = 0;
+  tp_fec_reset(fec);
+}
+
+sl_status_t tp_fec_config(tp_fec_t *fec, uint8_t k, uint8_t m)
+{
+  if (0 == k || m > TP_FEC_MAX_M || k + m > 255)
+  {
+    LOG_W("Invalid FEC configuration K=%u M=%u", k, m);
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  fec->k = k;
+  fec->m = m;
+  tp_fec_reset(fec);
+
+  return SL_STATUS_OK;
+}
+
+void tp_fec_reset(tp_fec_t *fec)
+{
+  fec->count = 0;
+  fec->length = 0;
+  memset(fec->parity, 0, (size_t)fec->m * TP_UDP_PACKET_SIZE);
+}
+
+bool tp_fec_add(tp_fec_t *fec, const uint8_t *payload, size_t length)
+{
+  if (0 == fec->m)
+    return false;
+
+  if (length > TP_UDP_PACKET_SIZE)
+    length = TP_UDP_PACKET_SIZE;
+  if (length > fec->length)
+    fec->length = length;
+
+  if (1 == fec->m)
+  {
+    uint8_t *parity = fec->parity[0];
+    for (size_t n = 0; n < length; n++)
+      parity[n] ^= payload[n];
+  }
+  else
+  {
+    // Multiplying by a fixed coefficient is a table lookup once the row is built
+    uint8_t row[256];
+    uint8_t y = fec->count;
+
+    for (uint8_t j = 0; j < fec->m; j++)
+    {
+      uint8_t coefficient = _tp_fec_inv((fec->k + j) ^ y);
+      uint8_t *parity = fec->parity[j];
+
+      for (uint16_t v = 0; v < 256; v++)
+        row[v] = _tp_fec_mul(coefficient, v);
+
+      for (size_t n = 0; n < length; n++)
+        parity[n] ^= row[payload[n]];
+    }
+  }
+
+  fec->count++;
+
+  return fec->count >= fec->k;
+}
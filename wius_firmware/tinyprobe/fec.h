@@ -0,0 +1,108 @@
+/**
+ * @file fec.h
+ *
+ * @brief Forward error correction for the TinyProbe data stream
+ *
+ * Data packets are protected in groups of K packets by M parity packets. M = 1 uses a plain XOR
+ * parity. M > 1 uses a systematic Reed-Solomon code over GF(2^8) (polynomial 0x11D) with the
+ * Cauchy matrix C[j][i] = 1 / ((K + j) ^ i), so any M lost packets of a group can be recovered.
+ * Parity is accumulated as the packets are produced, a group is complete after its K-th packet.
+ *
+ * A parity packet consists of a @ref wius_udp_frag_header_t with the
+ * @ref WIUS_UDP_FRAG_FLAG_PARITY flag and the index of the first data packet of the group, a
+ * @ref tp_fec_header_t and the parity over the data packet payloads.
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_FEC_H_
+#define TP_FEC_H_
+
+#include "common.h"
+
+/**
+ * @brief Parity packet header (follows the fragment header)
+ *
+ */
+typedef struct __attribute__((packed)) tp_fec_header
+{
+  uint8_t parity; /**< Parity index j within the group */
+  uint8_t count;  /**< Number of data packets in the group (K, less for the last group) */
+  uint8_t k;      /**< Configured group size K */
+  uint8_t m;      /**< Configured number of parity packets M */
+} tp_fec_header_t;
+
+/**
+ * @brief FEC encoder structure
+ *
+ * @warning Do not modify the structure directly
+ *
+ */
+typedef struct
+{
+  uint8_t k;                                         /**< Data packets per group */
+  uint8_t m;                                         /**< Parity packets per group (0 to disable) */
+  uint8_t count;                                     /**< Data packets in the current group */
+  size_t length;                                     /**< Longest payload in the current group */
+  uint8_t parity[TP_FEC_MAX_M][TP_UDP_PACKET_SIZE]; /**< Parity accumulators */
+} tp_fec_t;
+
+/**
+ * @brief Initialize the GF(2^8) tables and an encoder (disabled)
+ *
+ * @param fec: Encoder to initialize
+ *
+ */
+void tp_fec_init(tp_fec_t *fec);
+
+/**
+ * @brief Configure an encoder and start a new group
+ *
+ * @param fec: Encoder to configure
+ * @param k: Data packets per group (1 - 255)
+ * @param m: Parity packets per group (0 to disable, up to @ref TP_FEC_MAX_M)
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_INVALID_PARAMETER: Invalid K or M
+ *
+ */
+sl_status_t tp_fec_config(tp_fec_t *fec, uint8_t k, uint8_t m);
+
+/**
+ * @brief Start a new group, discarding the accumulated parity
+ *
+ * @param fec: Encoder
+ *
+ */
+void tp_fec_reset(tp_fec_t *fec);
+
+/**
+ * @brief Add a data packet payload to the current group
+ *
+ * @param fec: Encoder
+ * @param payload: Payload of the data packet
+ * @param length: Payload length (at most @ref TP_UDP_PACKET_SIZE)
+ *
+ * @return Whether the group is complete and its parity can be sent
+ *
+ */
+bool tp_fec_add(tp_fec_t *fec, const uint8_t *payload, size_t length);
+
+/**
+ * @brief Check whether FEC is enabled
+ *
+ * @param fec: Encoder
+ *
+ * @return Whether parity packets are produced
+ *
+ */
+static inline bool tp_fec_enabled(const tp_fec_t *fec)
+{
+  return fec->m > 0;
+}
+
+#endif /* TP_FEC_H_ */
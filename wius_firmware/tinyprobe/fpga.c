@@ -168,6 +168,42 @@ sl_status_t tp_fpga_read_cfg(uint8_t *value)
     return status;
 }
 
+sl_status_t tp_fpga_wait_tx_ready(uint32_t max_polls, uint32_t *polls)
+{
+    sl_status_t status = SL_STATUS_OK;
+    uint8_t value = 0;
+
+    for (*polls = 1; *polls <= max_polls; (*polls)++)
+    {
+        CHECK_STATUS(tp_fpga_read_cfg(&value));
+
+        if (value & SPI_CFG_TX_READY)
+        {
+            return status;
+        }
+    }
+
+    return SL_STATUS_TIMEOUT;
+}
+
+sl_status_t tp_fpga_read_fifo_level(uint32_t *bytes)
+{
+    sl_status_t status = SL_STATUS_OK;
+    uint8_t tx_buf[5] = {0};
+    uint8_t rx_buf[5];
+
+    tx_buf[0] = SPI_READ_CFG;
+    tx_buf[1] = SPI_DUMMY_ADDR;
+    *bytes = 0;
+
+    CHECK_STATUS(wius_spi_xfer(WIUS_SPI_INST_0, tx_buf, rx_buf, 5, true));
+
+    // rx_buf[2] is the configuration register
+    *bytes = rx_buf[3] | ((uint32_t)rx_buf[4] << 8);
+
+    return status;
+}
+
 sl_status_t tp_fpga_send_cmd(uint8_t cmd, uint8_t *answer)
 {
     sl_status_t status = SL_STATUS_OK;
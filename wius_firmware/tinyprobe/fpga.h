@@ -23,6 +23,9 @@
 
 #define SPI_DUMMY_ADDR 0
 
+// Configuration register status bits
+#define SPI_CFG_TX_READY (1 << 7) // Readout data is in the SPI TX buffer
+
 #define SPI_BURST_MODE_SIZE 1000
 
 // Commands for User logic (System controller)
@@ -120,6 +123,37 @@ sl_status_t tp_fpga_read_fifo(uint8_t *tx_buf, uint8_t *rx_buf, uint32_t len, bo
  */
 sl_status_t tp_fpga_read_cfg(uint8_t *value);
 
+/**
+ * @brief Wait until the readout data is in the SPI TX buffer of the FPGA
+ *
+ * Polls @ref SPI_CFG_TX_READY in the configuration register. Only used with
+ * @ref TP_FPGA_READY_HANDSHAKE, the bit position has to match the bitstream.
+ *
+ * @param max_polls: Maximum number of register reads
+ * @param polls: Pointer to store the number of register reads
+ *
+ * @retval SL_STATUS_OK: Data ready
+ * @retval SL_STATUS_TIMEOUT: Not ready after @p max_polls reads
+ * @retval other: Error during reading from the register
+ *
+ */
+sl_status_t tp_fpga_wait_tx_ready(uint32_t max_polls, uint32_t *polls);
+
+/**
+ * @brief Read the fill level of the FIFO of the FPGA
+ *
+ * The status bytes clocked out after the configuration register hold the number of bytes waiting
+ * in the SPI TX FIFO (u16, little endian). Only used with @ref TP_FPGA_FIFO_LEVEL, the layout
+ * has to match the bitstream.
+ *
+ * @param bytes: Pointer to store the number of bytes in the FIFO
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Error during reading from the register
+ *
+ */
+sl_status_t tp_fpga_read_fifo_level(uint32_t *bytes);
+
 /**
  * @brief Send a command to the FPGA
  *
@@ -0,0 +1,213 @@
+/**
+ * @file link.c
+ *
+ * @brief WiFi link monitor implementation for the TinyProbe
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "link.h"
+
+#include "cmsis_os2.h"
+#include "si91x_device.h"
+
+#include "tinyprobe/pacing.h"
+#include "tinyprobe/perf.h"
+#include "wius/udp.h"
+#include "wius/wifi.h"
+
+// Written by the monitor thread, read by the main and control threads
+tp_link_stats_t _tp_link_stats = {.adapt = TP_LINK_ADAPT};
+uint32_t _tp_link_good_samples = 0;
+
+// Configuration replaced while degraded, only used by the main thread
+tp_link_state_t _tp_link_applied = TP_LINK_GOOD;
+uint8_t _tp_link_fec_k = 0;
+uint8_t _tp_link_fec_m = 0;
+tp_pacing_stats_t _tp_link_pacing;
+// Configuration applied while degraded, a host may replace it in the meantime
+uint8_t _tp_link_adapted_fec_k = 0;
+uint8_t _tp_link_adapted_fec_m = 0;
+tp_pacing_stats_t _tp_link_adapted_pacing;
+
+sl_status_t (*_tp_link_reconnected)(void) = NULL;
+
+osThreadId_t _tp_link_thread_id = NULL;
+osThreadAttr_t _tp_link_thread_attr = {
+    .name = "TP link",
+    .stack_size = 1024,
+    .priority = TP_LINK_THREAD_PRIORITY,
+};
+
+void _tp_link_thread(void *argument);
+
+sl_status_t tp_link_init(sl_status_t (*reconnected)(void))
+{
+  _tp_link_reconnected = reconnected;
+
+  _tp_link_thread_id = osThreadNew(_tp_link_thread, NULL, &_tp_link_thread_attr);
+  if (NULL == _tp_link_thread_id)
+  {
+    LOG_E("Error creating link monitor thread");
+    return SL_STATUS_FAIL;
+  }
+
+  return SL_STATUS_OK;
+}
+
+void tp_link_set_adapt(bool adapt)
+{
+  _tp_link_stats.adapt = adapt;
+}
+
+void tp_link_adapt(tp_fec_t *fec)
+{
+  tp_link_state_t state = (tp_link_state_t)_tp_link_stats.state;
+  if (!_tp_link_stats.adapt)
+    state = TP_LINK_GOOD;
+
+  if (TP_LINK_UNKNOWN == state || state == _tp_link_applied)
+    return;
+
+  if (TP_LINK_DEGRADED == state)
+  {
+    _tp_link_fec_k = fec->k;
+    _tp_link_fec_m = fec->m;
+    tp_pacing_get(&_tp_link_pacing);
+
+    // Parity recovers isolated losses without a round trip
+    if (0 == fec->m)
+      tp_fec_config(fec, TP_LINK_FEC_K, TP_LINK_FEC_M);
+
+    // A fixed rate is halved, the adaptive controller already backs off
+    if (TP_PACING_FIXED == _tp_link_pacing.mode)
+    {
+      uint32_t rate = _tp_link_pacing.rate / 2;
+      tp_pacing_config(TP_PACING_FIXED, rate > TP_PACING_RATE_MIN ? rate : TP_PACING_RATE_MIN);
+    }
+    else if (TP_PACING_OFF == _tp_link_pacing.mode)
+    {
+      tp_pacing_config(TP_PACING_ADAPTIVE, 0);
+    }
+
+    _tp_link_adapted_fec_k = fec->k;
+    _tp_link_adapted_fec_m = fec->m;
+    tp_pacing_get(&_tp_link_adapted_pacing);
+
+    LOG_W("Link degraded (%d dBm, %u permille retries)", _tp_link_stats.rssi, _tp_link_stats.retry_permille);
+  }
+  else
+  {
+    // Only undo what is still ours, settings sent by the host while degraded are kept
+    if (fec->k == _tp_link_adapted_fec_k && fec->m == _tp_link_adapted_fec_m)
+      tp_fec_config(fec, _tp_link_fec_k, _tp_link_fec_m);
+
+    // The adaptive controller moves its rate on its own, only the mode tells
+    tp_pacing_stats_t pacing;
+    tp_pacing_get(&pacing);
+    if (pacing.mode == _tp_link_adapted_pacing.mode &&
+        (TP_PACING_FIXED != pacing.mode || pacing.rate == _tp_link_adapted_pacing.rate))
+      tp_pacing_config(_tp_link_pacing.mode, _tp_link_pacing.rate);
+
+    LOG_D("Link recovered");
+  }
+
+  _tp_link_applied = state;
+}
+
+void tp_link_get(tp_link_stats_t *stats)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = _tp_link_stats;
+  __set_PRIMASK(primask);
+}
+
+void _tp_link_thread(void *argument)
+{
+  (void)argument;
+
+  uint32_t udp_failed = 0;
+  bool reopen_pending = false;
+
+  while (1)
+  {
+    osDelay((TP_LINK_PERIOD_MS * TICKS_PER_SEC + 999) / 1000);
+
+    // The network processor gave up rejoining, reconnect through the fast path
+    if (!wius_wifi_is_connected())
+    {
+      if (SL_STATUS_OK != wius_wifi_reconnect())
+      {
+        continue;
+      }
+
+      // The sockets went down with the interface
+      reopen_pending = true;
+    }
+
+    // Retried every period until the sockets are back, the probe is unreachable without them
+    if (reopen_pending && NULL != _tp_link_reconnected)
+    {
+      if (SL_STATUS_OK != _tp_link_reconnected())
+      {
+        LOG_E("Error re-opening the sockets after reconnecting");
+        continue;
+      }
+
+      reopen_pending = false;
+    }
+
+    // Nothing is sent while idle, do not wake the network processor for samples
+    if (tp_perf_is_idle())
+      continue;
+
+    wius_wifi_link_t link;
+    if (SL_STATUS_OK != wius_wifi_get_link(&link))
+    {
+      continue;
+    }
+
+    wius_udp_tx_stats_t udp;
+    wius_udp_tx_get_stats(&udp);
+
+    tp_pacing_stats_t pacing;
+    tp_pacing_get(&pacing);
+
+    uint32_t retry_permille = link.tx_packets ? link.tx_retries * 1000 / link.tx_packets : 0;
+
+    bool degraded = link.rssi < TP_LINK_RSSI_MIN || retry_permille > TP_LINK_RETRY_MAX ||
+                    link.tx_failed > 0 || udp.failed != udp_failed;
+    udp_failed = udp.failed;
+
+    // Degrade at once, recover only after several good samples
+    tp_link_state_t state = (tp_link_state_t)_tp_link_stats.state;
+    if (degraded)
+    {
+      _tp_link_good_samples = 0;
+      state = TP_LINK_DEGRADED;
+    }
+    else if (TP_LINK_DEGRADED != state || ++_tp_link_good_samples >= TP_LINK_GOOD_SAMPLES)
+    {
+      state = TP_LINK_GOOD;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    _tp_link_stats.state = state;
+    _tp_link_stats.rssi = (int8_t)link.rssi;
+    _tp_link_stats.retry_permille = retry_permille > UINT16_MAX ? UINT16_MAX : retry_permille;
+    _tp_link_stats.samples++;
+    _tp_link_stats.tx_packets += link.tx_packets;
+    _tp_link_stats.tx_retries += link.tx_retries;
+    _tp_link_stats.tx_failed += link.tx_failed;
+    _tp_link_stats.rx_crc_bad += link.rx_crc_bad;
+    _tp_link_stats.udp_failed = udp.failed;
+    _tp_link_stats.throughput = pacing.throughput;
+    __set_PRIMASK(primask);
+  }
+}
@@ -0,0 +1,94 @@
+/**
+ * @file link.h
+ *
+ * @brief WiFi link monitor for the TinyProbe
+ *
+ * A low priority thread samples the signal strength and frame counters of the network processor
+ * every @ref TP_LINK_PERIOD_MS while the performance manager is not idle. While the link is
+ * degraded, the data path is made more robust (parity packets, lower pacing rate) and the
+ * previous configuration is restored after @ref TP_LINK_GOOD_SAMPLES good samples in a row,
+ * unless the host changed it in the meantime. A lost connection is reestablished by the monitor
+ * thread, which then has the sockets re-opened.
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_LINK_H_
+#define TP_LINK_H_
+
+#include "common.h"
+
+#include "tinyprobe/fec.h"
+
+/**
+ * @brief Link states enumeration
+ *
+ */
+typedef enum tp_link_state
+{
+  TP_LINK_UNKNOWN = 0, /**< Not sampled yet */
+  TP_LINK_GOOD,        /**< Link within the thresholds */
+  TP_LINK_DEGRADED     /**< Weak signal, many retries or dropped frames */
+} tp_link_state_t;
+
+/**
+ * @brief Link statistics (as sent by the LINK command)
+ *
+ */
+typedef struct __attribute__((packed)) tp_link_stats
+{
+  uint8_t state;           /**< Link state (@ref tp_link_state_t) */
+  uint8_t adapt;           /**< Whether the data path follows the link state */
+  int8_t rssi;             /**< Last signal strength in dBm */
+  uint16_t retry_permille; /**< Retransmissions per transmitted frame of the last sample in permille */
+  uint32_t samples;        /**< Number of samples */
+  uint32_t tx_packets;     /**< Transmitted frames */
+  uint32_t tx_retries;     /**< Frame retransmissions */
+  uint32_t tx_failed;      /**< Frames dropped after the retry limit */
+  uint32_t rx_crc_bad;     /**< Received frames with a CRC error */
+  uint32_t udp_failed;     /**< Datagrams rejected by the network processor */
+  uint32_t throughput;     /**< Throughput of the last shot in bytes/s */
+} tp_link_stats_t;
+
+/**
+ * @brief Start the link monitor thread
+ *
+ * @param reconnected: Called by the monitor thread after a reconnect to re-open the sockets
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_FAIL: Thread creation failed
+ *
+ */
+sl_status_t tp_link_init(sl_status_t (*reconnected)(void));
+
+/**
+ * @brief Enable or disable adapting the data path to the link state
+ *
+ * @param adapt: Whether to adapt
+ *
+ */
+void tp_link_set_adapt(bool adapt);
+
+/**
+ * @brief Apply the configuration for the current link state
+ *
+ * @param fec: Parity encoder of the data path
+ *
+ * @note Must be called by the thread that transmits, between shots
+ *
+ */
+void tp_link_adapt(tp_fec_t *fec);
+
+/**
+ * @brief Get the link statistics
+ *
+ * @param stats: Pointer to store the statistics
+ *
+ */
+void tp_link_get(tp_link_stats_t *stats);
+
+#endif /* TP_LINK_H_ */
@@ -0,0 +1,184 @@
+/**
+ * @file pacing.c
+ *
+ * @brief Transmit pacing implementation for the TinyProbe data stream
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "pacing.h"
+
+#include "cmsis_os2.h"
+#include "si91x_device.h"
+
+tp_pacing_mode_t _tp_pacing_mode = TP_PACING_OFF;
+uint32_t _tp_pacing_rate = 0;       // Bucket rate in bytes/s
+uint64_t _tp_pacing_tokens = 0;     // Tokens in bytes scaled by the core clock
+uint32_t _tp_pacing_last = 0;       // Cycle counter at the last refill
+uint32_t _tp_pacing_latency_us = 0; // Smoothed send latency
+uint32_t _tp_pacing_failures = 0;
+uint32_t _tp_pacing_bytes = 0;
+uint32_t _tp_pacing_throughput = 0;
+uint32_t _tp_pacing_shot_bytes = 0;
+uint32_t _tp_pacing_shot_start = 0;
+
+// The bucket is drained by the main thread and reconfigured by the control and link threads
+osMutexId_t _tp_pacing_mutex = NULL;
+
+void _tp_pacing_refill(void)
+{
+  uint32_t now = DWT->CYCCNT;
+  uint64_t burst = (uint64_t)TP_PACING_BURST * SystemCoreClock;
+
+  _tp_pacing_tokens += (uint64_t)(now - _tp_pacing_last) * _tp_pacing_rate;
+  if (_tp_pacing_tokens > burst)
+    _tp_pacing_tokens = burst;
+
+  _tp_pacing_last = now;
+}
+
+void tp_pacing_init(void)
+{
+  _tp_pacing_mutex = osMutexNew(NULL);
+
+  tp_pacing_config(TP_PACING_MODE, TP_PACING_RATE);
+}
+
+sl_status_t tp_pacing_config(tp_pacing_mode_t mode, uint32_t rate)
+{
+  if (mode >= TP_PACING_MODE_MAX)
+  {
+    LOG_W("%u is invalid pacing mode", mode);
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  osMutexAcquire(_tp_pacing_mutex, osWaitForever);
+
+  if (rate)
+  {
+    if (rate < TP_PACING_RATE_MIN)
+      rate = TP_PACING_RATE_MIN;
+    if (rate > TP_PACING_RATE_MAX)
+      rate = TP_PACING_RATE_MAX;
+
+    _tp_pacing_rate = rate;
+  }
+
+  _tp_pacing_mode = mode;
+  _tp_pacing_tokens = (uint64_t)TP_PACING_BURST * SystemCoreClock;
+  _tp_pacing_last = DWT->CYCCNT;
+
+  osMutexRelease(_tp_pacing_mutex);
+
+  return SL_STATUS_OK;
+}
+
+void tp_pacing_wait(size_t bytes)
+{
+  uint64_t needed = (uint64_t)bytes * SystemCoreClock;
+
+  osMutexAcquire(_tp_pacing_mutex, osWaitForever);
+
+  // Mode and rate may change while sleeping, check them again every round
+  _tp_pacing_refill();
+  while (TP_PACING_OFF != _tp_pacing_mode && _tp_pacing_tokens < needed)
+  {
+    // Sleep for longer deficits, spin for the last millisecond
+    uint32_t wait_ms = (uint32_t)((needed - _tp_pacing_tokens) / _tp_pacing_rate / (SystemCoreClock / 1000));
+    if (wait_ms > 1)
+    {
+      osMutexRelease(_tp_pacing_mutex);
+      osDelay((wait_ms - 1) * TICKS_PER_SEC / 1000 + 1);
+      osMutexAcquire(_tp_pacing_mutex, osWaitForever);
+    }
+
+    _tp_pacing_refill();
+  }
+
+  if (TP_PACING_OFF != _tp_pacing_mode)
+    _tp_pacing_tokens -= needed;
+
+  osMutexRelease(_tp_pacing_mutex);
+}
+
+void tp_pacing_feedback(size_t bytes, uint32_t cycles, sl_status_t status, uint32_t pending)
+{
+  uint32_t latency_us = cycles / (SystemCoreClock / 1000000);
+
+  osMutexAcquire(_tp_pacing_mutex, osWaitForever);
+
+  _tp_pacing_latency_us = (_tp_pacing_latency_us * 7 + latency_us) / 8;
+  _tp_pacing_bytes += bytes;
+  _tp_pacing_shot_bytes += bytes;
+
+  bool congested = SL_STATUS_OK != status;
+  if (congested)
+    _tp_pacing_failures++;
+
+  if (TP_PACING_ADAPTIVE != _tp_pacing_mode)
+  {
+    osMutexRelease(_tp_pacing_mutex);
+    return;
+  }
+
+  uint32_t rate = _tp_pacing_rate;
+  if (congested)
+    rate -= rate / 4;
+  else if (pending >= WIUS_UDP_TX_QUEUE_DEPTH * 3 / 4 || latency_us > TP_PACING_LATENCY_US)
+    rate -= rate / 16;
+  else if (pending <= WIUS_UDP_TX_QUEUE_DEPTH / 2)
+    rate += TP_PACING_RATE_STEP;
+
+  if (rate < TP_PACING_RATE_MIN)
+    rate = TP_PACING_RATE_MIN;
+  if (rate > TP_PACING_RATE_MAX)
+    rate = TP_PACING_RATE_MAX;
+
+  _tp_pacing_rate = rate;
+
+  osMutexRelease(_tp_pacing_mutex);
+}
+
+void tp_pacing_clock_changed(uint32_t old_clock)
+{
+  osMutexAcquire(_tp_pacing_mutex, osWaitForever);
+
+  // Cycles since the last refill ran on both clocks, they are dropped
+  _tp_pacing_tokens = _tp_pacing_tokens * (SystemCoreClock / 1000) / (old_clock / 1000);
+  _tp_pacing_last = DWT->CYCCNT;
+
+  _tp_pacing_shot_bytes = 0;
+  _tp_pacing_shot_start = DWT->CYCCNT;
+
+  osMutexRelease(_tp_pacing_mutex);
+}
+
+void tp_pacing_shot_start(void)
+{
+  _tp_pacing_shot_bytes = 0;
+  _tp_pacing_shot_start = DWT->CYCCNT;
+}
+
+void tp_pacing_shot_end(void)
+{
+  uint32_t cycles = DWT->CYCCNT - _tp_pacing_shot_start;
+
+  if (cycles)
+    _tp_pacing_throughput = (uint64_t)_tp_pacing_shot_bytes * SystemCoreClock / cycles;
+}
+
+void tp_pacing_get(tp_pacing_stats_t *stats)
+{
+  osMutexAcquire(_tp_pacing_mutex, osWaitForever);
+  stats->mode = _tp_pacing_mode;
+  stats->rate = _tp_pacing_rate;
+  stats->throughput = _tp_pacing_throughput;
+  stats->latency_us = _tp_pacing_latency_us;
+  stats->failures = _tp_pacing_failures;
+  stats->bytes = _tp_pacing_bytes;
+  osMutexRelease(_tp_pacing_mutex);
+}
@@ -0,0 +1,116 @@
+/**
+ * @file pacing.h
+ *
+ * @brief Transmit pacing for the TinyProbe data stream
+ *
+ * Outgoing data is shaped by a token bucket so bursts do not overflow the transmit queue of the
+ * network processor. In adaptive mode the bucket rate follows the link: it is lowered
+ * multiplicatively when sends fail, block or take long and the queue fills up, and raised
+ * additively while the link keeps up.
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_PACING_H_
+#define TP_PACING_H_
+
+#include "common.h"
+
+/**
+ * @brief Pacing modes enumeration
+ *
+ */
+typedef enum tp_pacing_mode
+{
+  TP_PACING_OFF = 0,  /**< Send as fast as possible */
+  TP_PACING_FIXED,    /**< Token bucket with a fixed rate */
+  TP_PACING_ADAPTIVE, /**< Token bucket with a rate adapted to the link */
+  TP_PACING_MODE_MAX  /**< Number of modes */
+} tp_pacing_mode_t;
+
+/**
+ * @brief Pacing statistics (as sent by the PACING command)
+ *
+ */
+typedef struct __attribute__((packed)) tp_pacing_stats
+{
+  uint8_t mode;        /**< Pacing mode (@ref tp_pacing_mode_t) */
+  uint32_t rate;       /**< Current bucket rate in bytes/s */
+  uint32_t throughput; /**< Throughput achieved by the last shot in bytes/s */
+  uint32_t latency_us; /**< Smoothed send latency per batch in us */
+  uint32_t failures;   /**< Number of failed or blocked sends */
+  uint32_t bytes;      /**< Number of bytes sent */
+} tp_pacing_stats_t;
+
+/**
+ * @brief Initialize pacing with the default configuration
+ *
+ */
+void tp_pacing_init(void);
+
+/**
+ * @brief Configure pacing
+ *
+ * @param mode: Pacing mode
+ * @param rate: Bucket rate in bytes/s (start rate in adaptive mode, 0 to keep the current rate)
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_INVALID_PARAMETER: Unknown mode
+ *
+ */
+sl_status_t tp_pacing_config(tp_pacing_mode_t mode, uint32_t rate);
+
+/**
+ * @brief Wait until enough tokens are available to send data
+ *
+ * @param bytes: Number of bytes about to be sent
+ *
+ */
+void tp_pacing_wait(size_t bytes);
+
+/**
+ * @brief Report the outcome of a send to the pacing controller
+ *
+ * @param bytes: Number of bytes accepted
+ * @param cycles: Duration of the send in CPU cycles
+ * @param status: Status of the send
+ * @param pending: Number of datagrams in flight after the send
+ *
+ */
+void tp_pacing_feedback(size_t bytes, uint32_t cycles, sl_status_t status, uint32_t pending);
+
+/**
+ * @brief Rescale the bucket after a core clock switch
+ *
+ * The tokens are scaled by the core clock, the throughput measurement of a running shot restarts.
+ *
+ * @param old_clock: Core clock before the switch in Hz
+ *
+ */
+void tp_pacing_clock_changed(uint32_t old_clock);
+
+/**
+ * @brief Mark the start of a shot for the throughput measurement
+ *
+ */
+void tp_pacing_shot_start(void);
+
+/**
+ * @brief Mark the end of a shot (all data handed over) for the throughput measurement
+ *
+ */
+void tp_pacing_shot_end(void);
+
+/**
+ * @brief Get the pacing statistics
+ *
+ * @param stats: Pointer to store the statistics
+ *
+ */
+void tp_pacing_get(tp_pacing_stats_t *stats);
+
+#endif /* TP_PACING_H_ */
@@ -0,0 +1,137 @@
+/**
+ * @file perf.c
+ *
+ * @brief WiFi performance profile manager implementation for the TinyProbe
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "perf.h"
+
+#include "cmsis_os2.h"
+
+#include "tinyprobe/pacing.h"
+#include "tinyprobe/profile.h"
+#include "wius/power.h"
+
+#if TP_PERF_IDLE_LOW_LATENCY
+#define TP_PERF_IDLE_PROFILE WIUS_PERF_PROFILE_LOWLATENCY
+#else
+#define TP_PERF_IDLE_PROFILE WIUS_PERF_PROFILE_LOWPOWER
+#endif
+
+// Only used by the main thread
+wius_wifi_performance_profile_t _tp_perf_profile = TP_PERF_IDLE_PROFILE;
+wius_wifi_performance_profile_t _tp_perf_active = WIUS_PERF_PROFILE_HIGHSPEED;
+uint32_t _tp_perf_last_active = 0;
+
+sl_status_t _tp_perf_switch(wius_wifi_performance_profile_t profile, uint8_t slot)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  uint32_t start = tp_profile_start();
+  CHECK_STATUS(wius_wifi_set_performance_profile(profile));
+  tp_profile_record(slot, start);
+
+  LOG_D("WiFi profile %u applied in %lu cycles", profile, DWT->CYCCNT - start);
+
+  _tp_perf_profile = profile;
+
+  return status;
+}
+
+sl_status_t _tp_perf_clock(bool high)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  uint32_t clock = SystemCoreClock;
+  CHECK_STATUS(high ? wius_power_m4_high() : wius_power_m4_low());
+
+  // Cycle based measurements have to follow the new clock
+  if (SystemCoreClock != clock)
+  {
+    tp_profile_clock_changed(clock);
+    tp_pacing_clock_changed(clock);
+  }
+
+  return status;
+}
+
+bool tp_perf_is_idle(void)
+{
+  return TP_PERF_IDLE_PROFILE == _tp_perf_profile && WIUS_POWER_MODE_LOW == wius_power_get_mode();
+}
+
+sl_status_t tp_perf_init(void)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  CHECK_STATUS(wius_power_init());
+  CHECK_STATUS(_tp_perf_clock(false));
+
+  return _tp_perf_switch(TP_PERF_IDLE_PROFILE, TP_PROFILE_SLOT_WIFI_IDLE);
+}
+
+sl_status_t tp_perf_acquire(uint32_t load)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  _tp_perf_last_active = osKernelGetTickCount();
+
+  // Small bursts are bound by the air time, not by the core
+  if (!TP_PERF_CLOCK_GOVERNOR || 0 == load || load >= TP_PERF_CLOCK_HIGH_BYTES)
+  {
+    CHECK_STATUS(_tp_perf_clock(true));
+  }
+
+  if (_tp_perf_active == _tp_perf_profile)
+    return status;
+
+  return _tp_perf_switch(_tp_perf_active, TP_PROFILE_SLOT_WIFI_ACTIVE);
+}
+
+sl_status_t tp_perf_set_active(wius_wifi_performance_profile_t profile)
+{
+  _tp_perf_active = profile;
+
+  // Apply right away if the idle timeout did not expire yet
+  if (TP_PERF_IDLE_PROFILE != _tp_perf_profile && _tp_perf_profile != profile)
+    return _tp_perf_switch(profile, TP_PROFILE_SLOT_WIFI_ACTIVE);
+
+  return SL_STATUS_OK;
+}
+
+void tp_perf_release(void)
+{
+  _tp_perf_last_active = osKernelGetTickCount();
+}
+
+uint32_t tp_perf_timeout(void)
+{
+  if (tp_perf_is_idle())
+    return osWaitForever;
+
+  uint32_t idle = osKernelGetTickCount() - _tp_perf_last_active;
+  uint32_t timeout = (TP_PERF_IDLE_TIMEOUT_MS * TICKS_PER_SEC + 999) / 1000;
+
+  return idle < timeout ? timeout - idle : 0;
+}
+
+sl_status_t tp_perf_idle(void)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  if (tp_perf_is_idle() || tp_perf_timeout() > 0)
+    return status;
+
+  CHECK_STATUS(_tp_perf_clock(false));
+
+  if (TP_PERF_IDLE_PROFILE == _tp_perf_profile)
+    return status;
+
+  return _tp_perf_switch(TP_PERF_IDLE_PROFILE, TP_PROFILE_SLOT_WIFI_IDLE);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file perf.h
+ *
+ * @brief WiFi performance profile and core clock manager for the TinyProbe
+ *
+ * Acquisitions run with the high performance profile. The manager keeps that profile while
+ * acquisitions keep coming and only switches to the power save profile after
+ * @ref TP_PERF_IDLE_TIMEOUT_MS without one. Each switch costs round trips to the network
+ * processor and would otherwise delay the first packet of every shot.
+ *
+ * The core clock follows the same idle timeout. A simple governor only raises it for bursts of
+ * at least @ref TP_PERF_CLOCK_HIGH_BYTES, smaller ones are bound by the air time and run on the
+ * power save clock.
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_PERF_H_
+#define TP_PERF_H_
+
+#include "common.h"
+
+#include "wius/wifi.h"
+
+/**
+ * @brief Initialize the manager and apply the idle profile and clock
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Setting the profile or clock failed
+ *
+ */
+sl_status_t tp_perf_init(void);
+
+/**
+ * @brief Switch to the acquisition profile and pick the core clock
+ *
+ * @param load: Expected bytes of the acquisition, 0 if unknown
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Setting the profile or clock failed
+ *
+ * @note Does nothing if the acquisition profile and clock are still active
+ *
+ */
+sl_status_t tp_perf_acquire(uint32_t load);
+
+/**
+ * @brief Set the profile used during acquisitions
+ *
+ * @param profile: Acquisition profile, the idle profile keeps the power save profile throughout
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Setting the profile failed
+ *
+ */
+sl_status_t tp_perf_set_active(wius_wifi_performance_profile_t profile);
+
+/**
+ * @brief Mark the end of an acquisition, starting the idle timeout
+ *
+ */
+void tp_perf_release(void);
+
+/**
+ * @brief Get the time until the idle timeout expires
+ *
+ * @return Time in ticks, osWaitForever if the idle profile and clock are active
+ *
+ */
+uint32_t tp_perf_timeout(void);
+
+/**
+ * @brief Check whether the idle profile and clock are active
+ *
+ * @return Whether the manager is idle
+ *
+ */
+bool tp_perf_is_idle(void);
+
+/**
+ * @brief Switch to the idle profile and clock if the idle timeout expired
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Setting the profile or clock failed
+ *
+ */
+sl_status_t tp_perf_idle(void);
+
+#endif /* TP_PERF_H_ */
@@ -12,40 +12,52 @@
 
 #include "power.h"
 
+#include "cmsis_os2.h"
 #include "sl_gpio_board.h"
 
+#include "tinyprobe/profile.h"
 #include "wius/gpio.h"
 #include "wius/gpio_ulp.h"
 
+#define TP_POWER_BIT(domain) (1 << (domain))
+
+// Domains switched off between acquisitions, -5V goes with the high voltage rails so the next
+// power up still brings them up before it
+#define TP_POWER_GATED (TP_POWER_BIT(TP_POWER_DOMAIN_LVDS_2_5V) | TP_POWER_BIT(TP_POWER_DOMAIN_POS_HV) \
+                        | TP_POWER_BIT(TP_POWER_DOMAIN_NEG_HV) | TP_POWER_BIT(TP_POWER_DOMAIN_NEG_5V))
+
 wius_gpio_ulp_t neg_5v_pin = WIUS_GPIO_ULP_OUTPUT(TP_POWER_GPIO_NEG_5V);
 wius_gpio_t neg_hv_pin = WIUS_GPIO_OUTPUT(TP_POWER_GPIO_NEG_HV);
 wius_gpio_t pos_hv_pin = WIUS_GPIO_OUTPUT(TP_POWER_GPIO_POS_HV);
 wius_gpio_ulp_t lvds_pwr_switch_pin = WIUS_GPIO_ULP_OUTPUT(TP_POWER_GPIO_LVDS_PWR_SW);
 
-void tp_power_init(void)
-{
-  wius_gpio_ulp_pin_config(&neg_5v_pin);
-  wius_gpio_pin_config(&neg_hv_pin);
-  wius_gpio_pin_config(&pos_hv_pin);
-  wius_gpio_ulp_pin_config(&lvds_pwr_switch_pin);
-
-  // Set all pins to low initially
-  wius_gpio_ulp_pin_set(neg_5v_pin, false);
-  wius_gpio_pin_set(neg_hv_pin, false);
-  wius_gpio_pin_set(pos_hv_pin, false);
-  wius_gpio_ulp_pin_set(lvds_pwr_switch_pin, false);
-}
+// Power up order, the high voltage rails come up before -5V
+const tp_power_domain_t _tp_power_sequence[] = {
+    TP_POWER_DOMAIN_POS_HV,
+    TP_POWER_DOMAIN_NEG_HV,
+    TP_POWER_DOMAIN_NEG_5V,
+    TP_POWER_DOMAIN_LVDS_2_5V,
+};
 
-void tp_power_on(void)
-{
-  wius_gpio_pin_set(pos_hv_pin, true);
-  wius_gpio_pin_set(neg_hv_pin, true);
-  delay_ms(100);
-  wius_gpio_ulp_pin_set(neg_5v_pin, true);
-  delay_ms(100);
-}
+// Only used by the main thread
+tp_power_state_t _tp_power_state = TP_POWER_STATE_OFF;
+uint8_t _tp_power_requested = 0;
+uint8_t _tp_power_enabled = 0;
+uint32_t _tp_power_last_active = 0;
+uint32_t _tp_power_acquire_start = 0;
+bool _tp_power_acquire_cold = false;
+bool _tp_power_measuring = false;
+tp_power_stats_t _tp_power_stats = {
+    .warm_ms = TP_POWER_WARM_MS,
+    .settle_ms = {
+        [TP_POWER_DOMAIN_LVDS_2_5V] = TP_POWER_SETTLE_LVDS_MS,
+        [TP_POWER_DOMAIN_POS_HV] = TP_POWER_SETTLE_POS_HV_MS,
+        [TP_POWER_DOMAIN_NEG_HV] = TP_POWER_SETTLE_NEG_HV_MS,
+        [TP_POWER_DOMAIN_NEG_5V] = TP_POWER_SETTLE_NEG_5V_MS,
+    },
+};
 
-void tp_power_set(tp_power_domain_t domain, bool enabled)
+void _tp_power_switch(tp_power_domain_t domain, bool enabled)
 {
   switch (domain)
   {
@@ -69,14 +81,221 @@ void tp_power_set(tp_power_domain_t domain, bool enabled)
     LOG_D("Changing -5V pin to %u", enabled);
     LOG_D("Pin is at %u", wius_gpio_ulp_pin_get(neg_5v_pin));
     break;
-  case TP_POWER_DOMAIN_PLL_PWD:
+  default:
+    return;
+  }
+
+  if (enabled)
+    _tp_power_enabled |= TP_POWER_BIT(domain);
+  else
+    _tp_power_enabled &= ~TP_POWER_BIT(domain);
+}
+
+void _tp_power_up(uint8_t domains)
+{
+  uint32_t enabled_at[TP_POWER_DOMAIN_MAX] = {0};
+  uint8_t pending = 0;
+
+  for (size_t i = 0; i < sizeof(_tp_power_sequence) / sizeof(_tp_power_sequence[0]); i++)
+  {
+    tp_power_domain_t domain = _tp_power_sequence[i];
+    if (!(domains & TP_POWER_BIT(domain)) || (_tp_power_enabled & TP_POWER_BIT(domain)))
+      continue;
+
+    _tp_power_switch(domain, true);
+    enabled_at[domain] = time_ms();
+    pending |= TP_POWER_BIT(domain);
+
+    // Domains without a settle time settle together with the next one
+    if (0 == _tp_power_stats.settle_ms[domain])
+      continue;
+
+    delay_ms(_tp_power_stats.settle_ms[domain]);
+
+    uint32_t now = time_ms();
+    for (uint8_t d = 0; d < TP_POWER_DOMAIN_MAX; d++)
+    {
+      if (pending & TP_POWER_BIT(d))
+        _tp_power_stats.settled_ms[d] = now - enabled_at[d];
+    }
+    pending = 0;
+  }
+
+  uint32_t now = time_ms();
+  for (uint8_t d = 0; d < TP_POWER_DOMAIN_MAX; d++)
+  {
+    if (pending & TP_POWER_BIT(d))
+      _tp_power_stats.settled_ms[d] = now - enabled_at[d];
+  }
+}
+
+void _tp_power_gate(void)
+{
+  // Reverse order of the power up
+  for (size_t i = sizeof(_tp_power_sequence) / sizeof(_tp_power_sequence[0]); i > 0; i--)
+  {
+    tp_power_domain_t domain = _tp_power_sequence[i - 1];
+    if ((TP_POWER_GATED & _tp_power_enabled) & TP_POWER_BIT(domain))
+      _tp_power_switch(domain, false);
+  }
+
+  _tp_power_state = _tp_power_enabled ? TP_POWER_STATE_STANDBY : TP_POWER_STATE_OFF;
+}
+
+void tp_power_init(void)
+{
+  wius_gpio_ulp_pin_config(&neg_5v_pin);
+  wius_gpio_pin_config(&neg_hv_pin);
+  wius_gpio_pin_config(&pos_hv_pin);
+  wius_gpio_ulp_pin_config(&lvds_pwr_switch_pin);
+
+  // Set all pins to low initially
+  wius_gpio_ulp_pin_set(neg_5v_pin, false);
+  wius_gpio_pin_set(neg_hv_pin, false);
+  wius_gpio_pin_set(pos_hv_pin, false);
+  wius_gpio_ulp_pin_set(lvds_pwr_switch_pin, false);
+
+  _tp_power_state = TP_POWER_STATE_OFF;
+  _tp_power_requested = 0;
+  _tp_power_enabled = 0;
+}
+
+void tp_power_on(void)
+{
+  _tp_power_requested |= TP_POWER_BIT(TP_POWER_DOMAIN_POS_HV) | TP_POWER_BIT(TP_POWER_DOMAIN_NEG_HV)
+                         | TP_POWER_BIT(TP_POWER_DOMAIN_NEG_5V);
+  _tp_power_up(_tp_power_requested);
+
+  _tp_power_state = TP_POWER_STATE_WARM;
+  _tp_power_last_active = osKernelGetTickCount();
+}
+
+void tp_power_set(tp_power_domain_t domain, bool enabled)
+{
+  if (TP_POWER_DOMAIN_PLL_PWD == domain)
+  {
     // TODO
     LOG_D("Changing PLL pin to %u", enabled);
 //    LOG_D("Pin is at %u", wius_gpio_ulp_pin_get(lvds_pwr_switch_pin));
     LOG_W("Not implemented");
-    break;
-  default:
     return;
   }
+  else if (domain >= TP_POWER_DOMAIN_MAX)
+  {
+    return;
+  }
+
+  if (!enabled)
+  {
+    _tp_power_requested &= ~TP_POWER_BIT(domain);
+    _tp_power_switch(domain, false);
+    if (!_tp_power_enabled)
+      _tp_power_state = TP_POWER_STATE_OFF;
+    return;
+  }
+
+  _tp_power_requested |= TP_POWER_BIT(domain);
+
+  // Enabling a gated domain leaves standby with everything requested
+  if (TP_POWER_STATE_WARM > _tp_power_state && (TP_POWER_GATED & TP_POWER_BIT(domain)))
+  {
+    _tp_power_up(_tp_power_requested);
+    _tp_power_state = TP_POWER_STATE_WARM;
+    _tp_power_last_active = osKernelGetTickCount();
+    return;
+  }
+
+  _tp_power_up(TP_POWER_BIT(domain));
+  if (TP_POWER_STATE_OFF == _tp_power_state)
+    _tp_power_state = TP_POWER_STATE_STANDBY;
+}
+
+void tp_power_config(uint32_t warm_ms, const uint16_t *settle_ms)
+{
+  _tp_power_stats.warm_ms = warm_ms;
+
+  if (NULL == settle_ms)
+    return;
+
+  for (uint8_t d = 0; d < TP_POWER_DOMAIN_MAX; d++)
+  {
+    if (UINT16_MAX != settle_ms[d])
+      _tp_power_stats.settle_ms[d] = settle_ms[d];
+  }
+}
+
+bool tp_power_acquire(void)
+{
+  _tp_power_acquire_start = tp_profile_start();
+  _tp_power_acquire_cold = TP_POWER_STATE_WARM > _tp_power_state;
+  _tp_power_measuring = true;
+
+  if (_tp_power_acquire_cold)
+  {
+    LOG_D("Leaving standby");
+    _tp_power_up(_tp_power_requested);
+  }
+
+  _tp_power_state = TP_POWER_STATE_ACTIVE;
+  _tp_power_last_active = osKernelGetTickCount();
+
+  return _tp_power_acquire_cold;
+}
+
+void tp_power_first_shot(void)
+{
+  if (!_tp_power_measuring)
+    return;
+
+  _tp_power_measuring = false;
+  uint32_t us = (DWT->CYCCNT - _tp_power_acquire_start) / (SystemCoreClock / 1000000);
+
+  if (_tp_power_acquire_cold)
+  {
+    _tp_power_stats.restarts_cold++;
+    _tp_power_stats.first_shot_cold_us = us;
+  }
+  else
+  {
+    _tp_power_stats.restarts_warm++;
+    _tp_power_stats.first_shot_warm_us = us;
+  }
+
+  LOG_D("First shot after %lu us from %s standby", us, _tp_power_acquire_cold ? "cold" : "warm");
+}
 
+void tp_power_release(void)
+{
+  if (TP_POWER_STATE_ACTIVE == _tp_power_state)
+    _tp_power_state = TP_POWER_STATE_WARM;
+
+  _tp_power_last_active = osKernelGetTickCount();
+}
+
+uint32_t tp_power_timeout(void)
+{
+  if (UINT32_MAX == _tp_power_stats.warm_ms || !(TP_POWER_GATED & _tp_power_enabled))
+    return osWaitForever;
+
+  // A failed acquisition may not have released, no acquisition runs while the main thread waits
+  uint32_t idle = osKernelGetTickCount() - _tp_power_last_active;
+  uint32_t timeout = (uint32_t)(((uint64_t)_tp_power_stats.warm_ms * TICKS_PER_SEC + 999) / 1000);
+
+  return idle < timeout ? timeout - idle : 0;
+}
+
+void tp_power_idle(void)
+{
+  if (tp_power_timeout() > 0)
+    return;
+
+  _tp_power_gate();
+  LOG_D("Entered standby");
+}
+
+void tp_power_get(tp_power_stats_t *stats)
+{
+  *stats = _tp_power_stats;
+  stats->state = _tp_power_state;
+  stats->requested = _tp_power_requested;
 }
@@ -3,6 +3,13 @@
  *
  * @brief Power control for the TinyProbe
  *
+ * The power domains follow a small state machine. Acquisitions run in the active state with all
+ * requested domains on. Afterwards the probe stays in warm standby with the high voltage rails,
+ * -5V and LVDS ready for a quick restart, and only gates them after @ref TP_POWER_WARM_MS without
+ * an acquisition. The next acquisition then waits for the settle time of every gated domain and
+ * configures the TX chip and the AFE again with the defaults of @ref tp_init. Registers written by
+ * the host since then are lost, so gating is off unless @ref TP_POWER_WARM_MS is set.
+ *
  * @author Cédric Hirschi, ETH Zürich
  * @date 08.04.2024
  *
@@ -25,9 +32,39 @@ typedef enum tp_power_domain
   TP_POWER_DOMAIN_POS_HV,        /**< Positive high voltage */
   TP_POWER_DOMAIN_NEG_HV,        /**< Negative high voltage */
   TP_POWER_DOMAIN_NEG_5V,        /**< Negative 5V */
-  TP_POWER_DOMAIN_PLL_PWD        /**< PLL power down */
+  TP_POWER_DOMAIN_PLL_PWD,       /**< PLL power down */
+  TP_POWER_DOMAIN_MAX            /**< Max domain marker (only used internally) */
 } tp_power_domain_t;
 
+/**
+ * @brief Power states enumeration
+ *
+ */
+typedef enum tp_power_state
+{
+  TP_POWER_STATE_OFF = 0, /**< All domains off */
+  TP_POWER_STATE_STANDBY, /**< LVDS, high voltage and -5V gated, the other requested domains on */
+  TP_POWER_STATE_WARM,    /**< All requested domains on and settled, no acquisition running */
+  TP_POWER_STATE_ACTIVE   /**< Acquisition running */
+} tp_power_state_t;
+
+/**
+ * @brief Power statistics (as sent by the STANDBY command)
+ *
+ */
+typedef struct __attribute__((packed)) tp_power_stats
+{
+  uint8_t state;                            /**< Power state (@ref tp_power_state_t) */
+  uint8_t requested;                        /**< Bit mask of the requested domains */
+  uint32_t warm_ms;                         /**< Warm standby time before gating */
+  uint16_t settle_ms[TP_POWER_DOMAIN_MAX];  /**< Settle time waited after enabling each domain */
+  uint16_t settled_ms[TP_POWER_DOMAIN_MAX]; /**< Measured time from enabling each domain until it was settled */
+  uint32_t restarts_cold;                   /**< Acquisitions started from standby */
+  uint32_t restarts_warm;                   /**< Acquisitions started from warm standby */
+  uint32_t first_shot_cold_us;              /**< Last time from power up to the first shot from standby */
+  uint32_t first_shot_warm_us;              /**< Last time from power up to the first shot from warm standby */
+} tp_power_stats_t;
+
 /**
  * @brief Initialize the power control module
  *
@@ -35,7 +72,9 @@ typedef enum tp_power_domain
 void tp_power_init(void);
 
 /**
- * @brief Initialize the power domain of the TinyProbe
+ * @brief Power up the domains of the TinyProbe
+ *
+ * Requests both high voltage rails and -5V and enters warm standby once they settled.
  *
  */
 void tp_power_on(void);
@@ -43,10 +82,66 @@ void tp_power_on(void);
 /**
  * @brief Enable or disable a power domain
  *
+ * A gated domain is only switched on with the next acquisition.
+ *
  * @param domain: Power domain to enable or disable
  * @param enabled: True to enable, false to disable
  *
  */
 void tp_power_set(tp_power_domain_t domain, bool enabled);
 
+/**
+ * @brief Configure warm standby and the settle times
+ *
+ * @param warm_ms: Time in warm standby before gating, UINT32_MAX never gates
+ * @param settle_ms: Settle time per domain, UINT16_MAX keeps the current one, NULL keeps all
+ *
+ */
+void tp_power_config(uint32_t warm_ms, const uint16_t *settle_ms);
+
+/**
+ * @brief Bring all requested domains up for an acquisition
+ *
+ * Starts the time to first shot measurement.
+ *
+ * @return Whether gated domains were brought back up, the TX chip and the AFE then lost their
+ *         configuration
+ *
+ */
+bool tp_power_acquire(void);
+
+/**
+ * @brief Record the first shot of an acquisition
+ *
+ */
+void tp_power_first_shot(void);
+
+/**
+ * @brief Mark the end of an acquisition, entering warm standby
+ *
+ */
+void tp_power_release(void);
+
+/**
+ * @brief Get the time until warm standby expires
+ *
+ * @return Time in ticks, osWaitForever if nothing is left to gate
+ *
+ */
+uint32_t tp_power_timeout(void);
+
+/**
+ * @brief Gate LVDS and the high voltage rails if warm standby expired
+ *
+ */
+void tp_power_idle(void);
+
+/**
+ * @brief Get the power statistics
+ *
+ * @param stats: Pointer to store the statistics
+ *
+ */
+void tp_power_get(tp_power_stats_t *stats);
+
 #endif /* TP_POWER_H_ */
@@ -0,0 +1,133 @@
+/**
+ * @file profile.c
+ *
+ * @brief Execution time profiling implementation for the TinyProbe
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "profile.h"
+
+/**
+ * @brief Profiling slot structure
+ *
+ * @note Only used internally
+ *
+ */
+typedef struct
+{
+  uint32_t count;                           /**< Number of measurements */
+  uint32_t min;                             /**< Minimum duration in cycles */
+  uint32_t max;                             /**< Maximum duration in cycles */
+  uint64_t total;                           /**< Sum of all durations in cycles */
+  uint16_t histogram[TP_PROFILE_HIST_BINS]; /**< Log2 histogram */
+} _tp_profile_entry_t;
+
+_tp_profile_entry_t _tp_profile_entries[TP_PROFILE_SLOT_MAX];
+
+// Last core clock switch, to split measurements running across it
+uint32_t _tp_profile_switch = 0;
+uint32_t _tp_profile_old_clock = 0;
+
+// Slots are recorded by the main thread and read or reset by the control thread
+#define _TP_PROFILE_LOCK()             \
+  uint32_t _primask = __get_PRIMASK(); \
+  __disable_irq()
+#define _TP_PROFILE_UNLOCK() __set_PRIMASK(_primask)
+
+void tp_profile_init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  tp_profile_reset();
+}
+
+void tp_profile_reset(void)
+{
+  _TP_PROFILE_LOCK();
+
+  memset(_tp_profile_entries, 0, sizeof(_tp_profile_entries));
+
+  for (size_t i = 0; i < TP_PROFILE_SLOT_MAX; i++)
+  {
+    _tp_profile_entries[i].min = UINT32_MAX;
+  }
+
+  _TP_PROFILE_UNLOCK();
+}
+
+void tp_profile_clock_changed(uint32_t old_clock)
+{
+  _TP_PROFILE_LOCK();
+  _tp_profile_switch = DWT->CYCCNT;
+  _tp_profile_old_clock = old_clock;
+  _TP_PROFILE_UNLOCK();
+}
+
+void tp_profile_record(uint8_t slot, uint32_t start)
+{
+  uint32_t now = DWT->CYCCNT;
+
+  if (slot >= TP_PROFILE_SLOT_MAX)
+  {
+    return;
+  }
+
+  _TP_PROFILE_LOCK();
+
+  // Normalize to the profiling clock, the part before a clock switch ran at the old clock
+  uint32_t cycles = now - start;
+  uint32_t after = now - _tp_profile_switch;
+  uint64_t normalized;
+  if (0 != _tp_profile_old_clock && after < cycles)
+    normalized = (uint64_t)(cycles - after) * TP_PROFILE_CLOCK_HZ / _tp_profile_old_clock +
+                 (uint64_t)after * TP_PROFILE_CLOCK_HZ / SystemCoreClock;
+  else if (TP_PROFILE_CLOCK_HZ != SystemCoreClock)
+    normalized = (uint64_t)cycles * TP_PROFILE_CLOCK_HZ / SystemCoreClock;
+  else
+    normalized = cycles;
+  cycles = normalized > UINT32_MAX ? UINT32_MAX : (uint32_t)normalized;
+
+  _tp_profile_entry_t *entry = &_tp_profile_entries[slot];
+
+  entry->count++;
+  entry->total += cycles;
+  if (cycles < entry->min)
+    entry->min = cycles;
+  if (cycles > entry->max)
+    entry->max = cycles;
+
+  uint8_t bin = cycles ? 31 - __builtin_clz(cycles) : 0;
+  if (entry->histogram[bin] != UINT16_MAX)
+    entry->histogram[bin]++;
+
+  _TP_PROFILE_UNLOCK();
+}
+
+sl_status_t tp_profile_get(uint8_t slot, tp_profile_stats_t *stats)
+{
+  if (slot >= TP_PROFILE_SLOT_MAX)
+  {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  _tp_profile_entry_t *entry = &_tp_profile_entries[slot];
+
+  _TP_PROFILE_LOCK();
+
+  stats->count = entry->count;
+  stats->min = entry->count ? entry->min : 0;
+  stats->mean = entry->count ? (uint32_t)(entry->total / entry->count) : 0;
+  stats->max = entry->max;
+  memcpy(stats->histogram, entry->histogram, sizeof(stats->histogram));
+
+  _TP_PROFILE_UNLOCK();
+
+  return SL_STATUS_OK;
+}
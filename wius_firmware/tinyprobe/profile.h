@@ -0,0 +1,122 @@
+/**
+ * @file profile.h
+ *
+ * @brief Execution time profiling for the TinyProbe
+ *
+ * Execution times are measured in CPU cycles with the DWT cycle counter and normalized to
+ * @ref TP_PROFILE_CLOCK_HZ, so slots stay comparable across core clock switches. Every profiling slot
+ * keeps a count, the minimum, the maximum, the sum (for the mean) and a log2 histogram, where bin
+ * i counts durations in [2^i, 2^(i+1)) cycles. Command slots leave out the time spent printing log
+ * messages (@ref log_cycles).
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_PROFILE_H_
+#define TP_PROFILE_H_
+
+#include "common.h"
+
+#include "si91x_device.h"
+
+#include "tinyprobe/command.h"
+
+#define TP_PROFILE_HIST_BINS 32         /**< Number of log2 histogram bins */
+#define TP_PROFILE_CLOCK_HZ 180000000   /**< Clock the recorded durations are normalized to */
+
+/**
+ * @brief Profiling slots enumeration
+ *
+ * @note Every command ID has its own slot, further slots measure code sections
+ *
+ */
+typedef enum tp_profile_slot
+{
+  TP_PROFILE_SLOT_COMMANDS = 0,             /**< First command slot (indexed by @ref tp_command_id_t) */
+  TP_PROFILE_SLOT_UDP_SEND = TP_CMD_ID_MAX, /**< Sending one data packet */
+  TP_PROFILE_SLOT_FEC_ENCODE,               /**< Adding one data packet to the FEC parity */
+  TP_PROFILE_SLOT_CMD_IMMEDIATE,            /**< Reception to completion of an immediate command batch */
+  TP_PROFILE_SLOT_CMD_QUEUED,               /**< Reception to execution start of a queued command batch */
+  TP_PROFILE_SLOT_WIFI_ACTIVE,              /**< Switching to the acquisition WiFi profile */
+  TP_PROFILE_SLOT_WIFI_IDLE,                /**< Switching to the idle WiFi profile */
+  TP_PROFILE_SLOT_FPGA_READY,               /**< Read enable until the readout data is ready */
+  TP_PROFILE_SLOT_WAKE_TO_DATA,             /**< Wakeup from sleep until the first shot was sent */
+  TP_PROFILE_SLOT_MAX                       /**< Number of slots */
+} tp_profile_slot_t;
+
+/**
+ * @brief Statistics of one profiling slot as sent by the GET_STATS command
+ *
+ */
+typedef struct __attribute__((packed)) tp_profile_stats
+{
+  uint32_t count;                          /**< Number of measurements */
+  uint32_t min;                            /**< Minimum duration in cycles of @ref TP_PROFILE_CLOCK_HZ */
+  uint32_t mean;                           /**< Mean duration in cycles of @ref TP_PROFILE_CLOCK_HZ */
+  uint32_t max;                            /**< Maximum duration in cycles of @ref TP_PROFILE_CLOCK_HZ */
+  uint16_t histogram[TP_PROFILE_HIST_BINS]; /**< Log2 histogram (saturating) */
+} tp_profile_stats_t;
+
+/**
+ * @brief Initialize the profiler and start the cycle counter
+ *
+ */
+void tp_profile_init(void);
+
+/**
+ * @brief Clear all profiling slots
+ *
+ */
+void tp_profile_reset(void);
+
+/**
+ * @brief Note a core clock switch
+ *
+ * Measurements running across the switch count their cycles before it at @p old_clock.
+ *
+ * @param old_clock: Core clock before the switch in Hz
+ *
+ * @note Call right after SystemCoreClock changed
+ *
+ */
+void tp_profile_clock_changed(uint32_t old_clock);
+
+/**
+ * @brief Get the start timestamp of a measurement
+ *
+ * @return Current cycle count
+ *
+ */
+static inline uint32_t tp_profile_start(void)
+{
+  return DWT->CYCCNT;
+}
+
+/**
+ * @brief Record a measurement that started at @p start
+ *
+ * @param slot: Profiling slot to record into
+ * @param start: Timestamp from @ref tp_profile_start
+ *
+ * @note Durations longer than one cycle counter period (about 23 s at 180 MHz) wrap
+ *
+ */
+void tp_profile_record(uint8_t slot, uint32_t start);
+
+/**
+ * @brief Get the statistics of a profiling slot
+ *
+ * @param slot: Profiling slot
+ * @param stats: Pointer to store the statistics
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_INVALID_PARAMETER: Invalid slot
+ *
+ */
+sl_status_t tp_profile_get(uint8_t slot, tp_profile_stats_t *stats);
+
+#endif /* TP_PROFILE_H_ */
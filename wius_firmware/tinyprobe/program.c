@@ -0,0 +1,199 @@
+/**
+ * @file program.c
+ *
+ * @brief Stored command programs implementation for the TinyProbe
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "program.h"
+
+#include "tinyprobe/command.h"
+
+#if TP_PROGRAM_FLASH
+#include "nvm3_default.h"
+
+#define TP_PROGRAM_NVM3_KEY_BASE 0x1000 // NVM3 key of program slot 0
+#endif
+
+/**
+ * @brief Program slot structure
+ *
+ * @note Only used internally
+ *
+ */
+typedef struct
+{
+    tp_command_t commands[TP_PROGRAM_MAX_COMMANDS]; /**< Pre-decoded commands */
+    uint16_t num_commands;                          /**< Number of commands */
+    uint8_t args[TP_PROGRAM_MAX_ARGS];              /**< Storage for the command arguments */
+    bool valid;                                     /**< Whether a program is stored in the slot */
+} _tp_program_t;
+
+_tp_program_t _tp_programs[TP_PROGRAM_NUM];
+
+// Scratch space for decoding a batch before it is copied into a slot
+tp_command_t _tp_program_decoded[TP_PROGRAM_MAX_COMMANDS];
+uint8_t _tp_program_arena[TP_PROGRAM_MAX_ARGS];
+
+#if TP_PROGRAM_FLASH
+// Raw batch buffer for loading programs from flash
+uint8_t _tp_program_flash_buffer[TP_WIFI_RX_BUFFER_SIZE];
+#endif
+
+sl_status_t _tp_program_load(uint8_t slot, uint8_t *batch, size_t batch_length)
+{
+    sl_status_t status = SL_STATUS_OK;
+    uint16_t num_commands = 0;
+    _tp_program_t *program = &_tp_programs[slot];
+
+    CHECK_STATUS(tp_command_decode(batch, batch_length, _tp_program_decoded, TP_PROGRAM_MAX_COMMANDS,
+                                   &num_commands, _tp_program_arena, sizeof(_tp_program_arena)));
+
+    size_t args_length = 0;
+    for (uint16_t i = 0; i < num_commands; i++)
+    {
+        if (_tp_program_decoded[i].id == TP_CMD_PROG_STORE || _tp_program_decoded[i].id == TP_CMD_PROG_RUN)
+        {
+            LOG_W("Programs may not contain program commands");
+            return SL_STATUS_INVALID_PARAMETER;
+        }
+
+        args_length += _tp_program_decoded[i].args_length;
+    }
+
+    if (args_length > TP_PROGRAM_MAX_ARGS)
+    {
+        LOG_W("Program arguments too long (%u > %u)", args_length, TP_PROGRAM_MAX_ARGS);
+        return SL_STATUS_WOULD_OVERFLOW;
+    }
+
+    // Copy the arguments into the slot so the program outlives the receive buffer
+    program->valid = false;
+    args_length = 0;
+    for (uint16_t i = 0; i < num_commands; i++)
+    {
+        memcpy(&program->args[args_length], _tp_program_decoded[i].args, _tp_program_decoded[i].args_length);
+
+        program->commands[i] = _tp_program_decoded[i];
+        program->commands[i].args = &program->args[args_length];
+
+        args_length += _tp_program_decoded[i].args_length;
+    }
+    program->num_commands = num_commands;
+    program->valid = true;
+
+    return status;
+}
+
+void tp_program_init(void)
+{
+    memset(_tp_programs, 0, sizeof(_tp_programs));
+
+#if TP_PROGRAM_FLASH
+    for (uint8_t slot = 0; slot < TP_PROGRAM_NUM; slot++)
+    {
+        uint32_t type = 0;
+        size_t length = 0;
+
+        if (ECODE_NVM3_OK != nvm3_getObjectInfo(nvm3_defaultHandle, TP_PROGRAM_NVM3_KEY_BASE + slot, &type, &length))
+        {
+            continue;
+        }
+
+        if (length > sizeof(_tp_program_flash_buffer) ||
+            ECODE_NVM3_OK != nvm3_readData(nvm3_defaultHandle, TP_PROGRAM_NVM3_KEY_BASE + slot,
+                                           _tp_program_flash_buffer, length))
+        {
+            LOG_W("Error reading program %u from flash", slot);
+            continue;
+        }
+
+        if (SL_STATUS_OK != _tp_program_load(slot, _tp_program_flash_buffer, length))
+        {
+            LOG_W("Invalid program %u in flash", slot);
+            continue;
+        }
+
+        LOG_D("Loaded program %u from flash", slot);
+    }
+#endif
+}
+
+sl_status_t tp_program_store(uint8_t *args, uint16_t args_length)
+{
+    LOG_D("Executing");
+
+    sl_status_t status = SL_STATUS_OK;
+
+    uint8_t slot = *args;
+    bool persist = *(bool *)(args + 1);
+    uint8_t *batch = args + 2;
+    uint16_t batch_length = args_length - 2;
+
+    if (slot >= TP_PROGRAM_NUM)
+    {
+        LOG_W("%u is invalid slot (0 - %u)", slot, TP_PROGRAM_NUM - 1);
+        return SL_STATUS_INVALID_PARAMETER;
+    }
+
+    CHECK_STATUS(_tp_program_load(slot, batch, batch_length));
+
+    if (persist)
+    {
+#if TP_PROGRAM_FLASH
+        if (ECODE_NVM3_OK != nvm3_writeData(nvm3_defaultHandle, TP_PROGRAM_NVM3_KEY_BASE + slot, batch, batch_length))
+        {
+            LOG_E("Error persisting program %u", slot);
+            return SL_STATUS_FAIL;
+        }
+#else
+        LOG_W("Flash persistence disabled, program %u kept in RAM only", slot);
+#endif
+    }
+
+    LOG_D("Stored %u commands in slot %u", _tp_programs[slot].num_commands, slot);
+
+    LOG_D("Done");
+
+    return status;
+}
+
+sl_status_t tp_program_run(uint8_t *args, uint16_t args_length)
+{
+    LOG_D("Executing");
+
+    (void)args_length;
+    sl_status_t status = SL_STATUS_OK;
+
+    uint8_t slot = *args;
+    uint16_t repeat = *(uint16_t *)(args + 1);
+
+    if (slot >= TP_PROGRAM_NUM || repeat == 0)
+    {
+        LOG_W("Invalid slot %u or repeat count %u", slot, repeat);
+        return SL_STATUS_INVALID_PARAMETER;
+    }
+
+    _tp_program_t *program = &_tp_programs[slot];
+    if (!program->valid)
+    {
+        LOG_W("No program stored in slot %u", slot);
+        return SL_STATUS_NOT_FOUND;
+    }
+
+    // All repeats share one execution budget
+    uint32_t start_time = time_ms();
+    for (uint16_t i = 0; i < repeat; i++)
+    {
+        CHECK_STATUS(tp_command_execute_list(program->commands, program->num_commands, start_time));
+    }
+
+    LOG_D("Done");
+
+    return status;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file program.h
+ *
+ * @brief Stored command programs for the TinyProbe
+ *
+ * A program is a validated command batch stored under a slot ID. The batch is decoded once when
+ * it is stored, so running a program skips parsing entirely.
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_PROGRAM_H_
+#define TP_PROGRAM_H_
+
+#include "common.h"
+
+/**
+ * @brief Initialize the program slots
+ *
+ * @note Loads the programs persisted to flash if @ref TP_PROGRAM_FLASH is enabled
+ *
+ */
+void tp_program_init(void);
+
+/**
+ * @brief Store a command batch in a program slot
+ *
+ * <table class="tg">
+ * <tbody>
+ *   <tr>
+ *     <th class="tg-1wig">Byte</th>
+ *     <th class="tg-0lax">0</th>
+ *     <th class="tg-0lax">1</th>
+ *     <th class="tg-0lax">2 ...</th>
+ *   </tr>
+ *   <tr>
+ *     <td class="tg-1wig">Description</td>
+ *     <td class="tg-0lax">slot<br><span style="font-style:italic">[uint8_t]</span></td>
+ *     <td class="tg-0lax">persist to flash<br><span style="font-style:italic">[bool]</span></td>
+ *     <td class="tg-0lax">command batch (same layout as a command packet)</td>
+ *   </tr>
+ * </tbody>
+ * </table>
+ *
+ * @param args: Command arguments
+ * @param args_length: Length of the command arguments
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_INVALID_PARAMETER: Invalid slot or malformed batch
+ * @retval SL_STATUS_WOULD_OVERFLOW: Batch does not fit into a program slot
+ * @retval other: Persisting the program failed
+ *
+ * @note Programs may not store or run other programs
+ *
+ */
+sl_status_t tp_program_store(uint8_t *args, uint16_t args_length);
+
+/**
+ * @brief Run a stored program
+ *
+ * <table class="tg">
+ * <tbody>
+ *   <tr>
+ *     <th class="tg-1wig">Byte</th>
+ *     <th class="tg-0lax">0</th>
+ *     <th class="tg-0lax">1</th>
+ *     <th class="tg-0lax">2</th>
+ *   </tr>
+ *   <tr>
+ *     <td class="tg-1wig">Description</td>
+ *     <td class="tg-0lax">slot<br><span style="font-style:italic">[uint8_t]</span></td>
+ *     <td class="tg-0lax" colspan="2">repeat count<br><span style="font-style:italic">[uint16_t]</span></td>
+ *   </tr>
+ * </tbody>
+ * </table>
+ *
+ * @param args: Command arguments
+ * @param args_length: Length of the command arguments
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_INVALID_PARAMETER: Invalid slot or repeat count
+ * @retval SL_STATUS_NOT_FOUND: No program stored in the slot
+ * @retval SL_STATUS_TIMEOUT: All repeats together ran longer than @ref TP_COMMAND_MAX_EXEC_MS
+ * @retval other: A command of the program failed
+ *
+ */
+sl_status_t tp_program_run(uint8_t *args, uint16_t args_length);
+
+#endif /* TP_PROGRAM_H_ */
@@ -0,0 +1,283 @@
+/**
+ * @file retx.c
+ *
+ * @brief Retransmission cache implementation for the TinyProbe
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "retx.h"
+
+#include "cmsis_os2.h"
+
+/**
+ * @brief Cached packet structure
+ *
+ * @note Only used internally
+ *
+ */
+typedef struct
+{
+  tp_buffer_slot_t *slot; /**< Referenced slot (NULL if unused) */
+  uint16_t frame;         /**< Frame ID of the packet */
+  uint16_t index;         /**< Fragment index of the packet */
+} _tp_retx_entry_t;
+
+/**
+ * @brief Queued retransmission structure
+ *
+ * @note Only used internally
+ *
+ */
+typedef struct
+{
+  tp_buffer_slot_t *slot; /**< Referenced slot */
+  wius_udp_peer_t peer;   /**< Subscriber that requested the packet */
+} _tp_retx_request_t;
+
+// Cache ring, stored into by the main thread and searched by the control thread
+osMutexId_t _tp_retx_mutex = NULL;
+_tp_retx_entry_t _tp_retx_cache[TP_RETX_CACHE_PACKETS];
+size_t _tp_retx_next = 0;
+uint16_t _tp_retx_frame = 0;
+bool _tp_retx_has_frame = false;
+
+volatile bool _tp_retx_paused = false;
+
+tp_buffer_t *_tp_retx_buf = NULL;
+wius_udp_t *_tp_retx_udp = NULL;
+const wius_udp_peer_t *(*_tp_retx_sender)(void) = NULL;
+
+// Private packet copies, the cached slots may still be queued for the original send
+uint8_t _tp_retx_copies[TP_RETX_COPIES][TP_BUFFER_REGION_SIZE] __attribute__((aligned(TP_BUFFER_ALIGN)));
+osMessageQueueId_t _tp_retx_copies_free = NULL;
+
+osMessageQueueId_t _tp_retx_queue = NULL;
+osThreadId_t _tp_retx_thread_id = NULL;
+osThreadAttr_t _tp_retx_thread_attr = {
+    .name = "TP retransmit",
+    .stack_size = 1024,
+    .priority = TP_RETX_THREAD_PRIORITY,
+};
+
+void _tp_retx_thread(void *argument);
+void _tp_retx_done(void *context);
+
+sl_status_t tp_retx_init(tp_buffer_t *buf, wius_udp_t *udp, const wius_udp_peer_t *(*sender)(void))
+{
+  _tp_retx_buf = buf;
+  _tp_retx_udp = udp;
+  _tp_retx_sender = sender;
+
+  memset(_tp_retx_cache, 0, sizeof(_tp_retx_cache));
+  _tp_retx_next = 0;
+  _tp_retx_has_frame = false;
+
+  _tp_retx_mutex = osMutexNew(NULL);
+  if (NULL == _tp_retx_mutex)
+  {
+    LOG_E("Error creating retransmit mutex");
+    return SL_STATUS_FAIL;
+  }
+
+  _tp_retx_copies_free = osMessageQueueNew(TP_RETX_COPIES, sizeof(uint8_t *), NULL);
+  if (NULL == _tp_retx_copies_free)
+  {
+    LOG_E("Error creating retransmit copy queue");
+    return SL_STATUS_FAIL;
+  }
+
+  for (size_t i = 0; i < TP_RETX_COPIES; i++)
+  {
+    uint8_t *copy = _tp_retx_copies[i];
+    osMessageQueuePut(_tp_retx_copies_free, &copy, 0, 0);
+  }
+
+  _tp_retx_queue = osMessageQueueNew(TP_RETX_QUEUE_SIZE, sizeof(_tp_retx_request_t), NULL);
+  if (NULL == _tp_retx_queue)
+  {
+    LOG_E("Error creating retransmit queue");
+    return SL_STATUS_FAIL;
+  }
+
+  _tp_retx_thread_id = osThreadNew(_tp_retx_thread, NULL, &_tp_retx_thread_attr);
+  if (NULL == _tp_retx_thread_id)
+  {
+    LOG_E("Error creating retransmit thread");
+    return SL_STATUS_FAIL;
+  }
+
+  return SL_STATUS_OK;
+}
+
+void tp_retx_store(tp_buffer_slot_t *slot)
+{
+  wius_udp_frag_header_t header;
+  memcpy(&header, tp_buffer_packet(slot), sizeof(header));
+
+  osMutexAcquire(_tp_retx_mutex, osWaitForever);
+
+  // Evict packets of shots that fell out of the window
+  if (!_tp_retx_has_frame || header.frame != _tp_retx_frame)
+  {
+    for (size_t i = 0; i < TP_RETX_CACHE_PACKETS; i++)
+    {
+      _tp_retx_entry_t *entry = &_tp_retx_cache[i];
+      if (NULL != entry->slot && (uint16_t)(header.frame - entry->frame) >= TP_RETX_CACHE_SHOTS)
+      {
+        tp_buffer_return(_tp_retx_buf, entry->slot, true);
+        entry->slot = NULL;
+      }
+    }
+
+    _tp_retx_frame = header.frame;
+    _tp_retx_has_frame = true;
+  }
+
+  _tp_retx_entry_t *entry = &_tp_retx_cache[_tp_retx_next];
+  if (NULL != entry->slot)
+  {
+    tp_buffer_return(_tp_retx_buf, entry->slot, true);
+  }
+
+  tp_buffer_ref(slot);
+  entry->slot = slot;
+  entry->frame = header.frame;
+  entry->index = header.index;
+
+  _tp_retx_next = (_tp_retx_next + 1) % TP_RETX_CACHE_PACKETS;
+
+  osMutexRelease(_tp_retx_mutex);
+}
+
+void tp_retx_pause(bool paused)
+{
+  _tp_retx_paused = paused;
+}
+
+sl_status_t tp_retx_nack(uint8_t *args, uint16_t args_length)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  if (args_length < 5 || NULL == _tp_retx_queue)
+  {
+    LOG_W("Invalid NACK");
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  uint16_t frame = *(uint16_t *)(args + 0);
+  uint16_t first = *(uint16_t *)(args + 2);
+  uint16_t missing = 0;
+  uint16_t queued = 0;
+
+  // Retransmit only to the subscriber that is missing the packets
+  _tp_retx_request_t request = {.peer = *_tp_retx_sender()};
+
+  osMutexAcquire(_tp_retx_mutex, osWaitForever);
+
+  for (uint16_t bit = 0; bit < (args_length - 4) * 8; bit++)
+  {
+    if (!(args[4 + bit / 8] & (1 << (bit % 8))))
+    {
+      continue;
+    }
+
+    uint16_t index = first + bit;
+    missing++;
+
+    tp_buffer_slot_t *slot = NULL;
+    for (size_t i = 0; i < TP_RETX_CACHE_PACKETS; i++)
+    {
+      _tp_retx_entry_t *entry = &_tp_retx_cache[i];
+      if (NULL != entry->slot && entry->frame == frame && entry->index == index)
+      {
+        slot = entry->slot;
+        break;
+      }
+    }
+
+    if (NULL == slot)
+    {
+      status = SL_STATUS_NOT_FOUND;
+      continue;
+    }
+
+    // The queued reference is dropped once the packet is copied for retransmission
+    tp_buffer_ref(slot);
+    request.slot = slot;
+    if (osOK != osMessageQueuePut(_tp_retx_queue, &request, 0, 0))
+    {
+      tp_buffer_return(_tp_retx_buf, slot, true);
+      status = SL_STATUS_FULL;
+      break;
+    }
+
+    queued++;
+  }
+
+  osMutexRelease(_tp_retx_mutex);
+
+  LOG_D("NACK for frame %u: %u missing, %u queued", frame, missing, queued);
+
+  return status;
+}
+
+void _tp_retx_done(void *context)
+{
+  uint8_t *copy = (uint8_t *)context;
+  osMessageQueuePut(_tp_retx_copies_free, &copy, 0, 0);
+}
+
+void _tp_retx_thread(void *argument)
+{
+  (void)argument;
+
+  _tp_retx_request_t request;
+
+  while (1)
+  {
+    if (osOK != osMessageQueueGet(_tp_retx_queue, &request, NULL, osWaitForever))
+    {
+      continue;
+    }
+
+    tp_buffer_slot_t *slot = request.slot;
+
+    // Live data goes first, retransmit only into a mostly idle transmit queue
+    while (_tp_retx_paused || wius_udp_tx_pending() >= WIUS_UDP_TX_QUEUE_DEPTH / 2)
+    {
+      osDelay(1);
+    }
+
+    // The cached slot may still be queued for the original send or other subscribers, mark the
+    // retransmission in a private copy only
+    uint8_t *copy = NULL;
+    osMessageQueueGet(_tp_retx_copies_free, &copy, NULL, osWaitForever);
+
+    size_t length = slot->length;
+    if (length > sizeof(_tp_retx_copies[0]))
+    {
+      LOG_W("Retransmit packet too long (%u bytes)", length);
+      tp_buffer_return(_tp_retx_buf, slot, true);
+      osMessageQueuePut(_tp_retx_copies_free, &copy, 0, 0);
+      continue;
+    }
+
+    memcpy(copy, tp_buffer_packet(slot), length);
+    tp_buffer_return(_tp_retx_buf, slot, true);
+
+    wius_udp_frag_header_t *header = (wius_udp_frag_header_t *)copy;
+    header->flags |= WIUS_UDP_FRAG_FLAG_RETRANSMIT;
+
+    sl_status_t status = wius_udp_sendto_peer_async(_tp_retx_udp, copy, length, &request.peer, _tp_retx_done,
+                                                    copy, 0);
+    if (SL_STATUS_OK != status)
+    {
+      osMessageQueuePut(_tp_retx_copies_free, &copy, 0, 0);
+    }
+  }
+}
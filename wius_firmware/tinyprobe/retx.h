@@ -0,0 +1,93 @@
+/**
+ * @file retx.h
+ *
+ * @brief Retransmission cache for the TinyProbe
+ *
+ * Sent data packets of the last @ref TP_RETX_CACHE_SHOTS shots stay referenced in a bounded
+ * cache. The host reports missing packets with NACK commands and only those are sent again,
+ * from a separate thread that gives way to live data. Cached packets are never modified, the
+ * retransmit flag is set in a private copy (@ref TP_RETX_COPIES in flight).
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_RETX_H_
+#define TP_RETX_H_
+
+#include "common.h"
+
+#include "tinyprobe/buffer.h"
+#include "wius/udp.h"
+
+/**
+ * @brief Initialize the retransmission cache and start its thread
+ *
+ * @param buf: Buffer pool the cached packets belong to
+ * @param udp: UDP connection to retransmit over
+ * @param sender: Returns the sender of the command being executed, retransmissions go to the sender of the NACK
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_FAIL: Thread or queue creation failed
+ *
+ */
+sl_status_t tp_retx_init(tp_buffer_t *buf, wius_udp_t *udp, const wius_udp_peer_t *(*sender)(void));
+
+/**
+ * @brief Keep a packet for retransmission
+ *
+ * Takes a reference to the slot, whose packet must start with a @ref wius_udp_frag_header_t.
+ * The oldest packet is evicted if the cache is full, packets of shots older than
+ * @ref TP_RETX_CACHE_SHOTS are evicted when a new shot starts.
+ *
+ * @param slot: Buffer slot holding the packet
+ *
+ */
+void tp_retx_store(tp_buffer_slot_t *slot);
+
+/**
+ * @brief Hold back retransmissions while live data is sent
+ *
+ * @param paused: Whether retransmissions are held back
+ *
+ */
+void tp_retx_pause(bool paused);
+
+/**
+ * @brief Queue missing packets for retransmission (NACK command)
+ *
+ * <table class="tg">
+ * <tbody>
+ *   <tr>
+ *     <th class="tg-1wig">Byte</th>
+ *     <th class="tg-0lax">0 - 1</th>
+ *     <th class="tg-0lax">2 - 3</th>
+ *     <th class="tg-0lax">4 ...</th>
+ *   </tr>
+ *   <tr>
+ *     <td class="tg-1wig">Content</td>
+ *     <td class="tg-0lax">Frame ID (u16)</td>
+ *     <td class="tg-0lax">First fragment index (u16)</td>
+ *     <td class="tg-0lax">Bitmap of missing fragments</td>
+ *   </tr>
+ * </tbody>
+ * </table>
+ *
+ * Bit b of bitmap byte k marks fragment first + 8 * k + b as missing. Several ranges are sent
+ * as several NACK commands.
+ *
+ * @param args: Command arguments
+ * @param args_length: Length of the command arguments
+ *
+ * @retval SL_STATUS_OK: All missing packets were queued
+ * @retval SL_STATUS_INVALID_PARAMETER: Arguments too short
+ * @retval SL_STATUS_NOT_FOUND: Some packets are no longer cached
+ * @retval SL_STATUS_FULL: Retransmission queue is full
+ *
+ */
+sl_status_t tp_retx_nack(uint8_t *args, uint16_t args_length);
+
+#endif /* TP_RETX_H_ */
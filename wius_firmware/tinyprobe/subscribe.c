@@ -0,0 +1,135 @@
+/**
+ * @file subscribe.c
+ *
+ * @brief Data stream subscribers implementation for the TinyProbe
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "subscribe.h"
+
+#include "si91x_device.h"
+
+// Subscriber table, updated by the control thread and copied out by the data path
+wius_udp_peer_t _tp_subscribers[TP_SUBSCRIBER_MAX];
+size_t _tp_num_subscribers = 0;
+
+wius_udp_peer_t _tp_multicast_group;
+bool _tp_multicast_enabled = false;
+
+int _tp_subscribe_find(const wius_udp_peer_t *peer)
+{
+  for (size_t i = 0; i < _tp_num_subscribers; i++)
+  {
+    if (_tp_subscribers[i].address.sin_addr.s_addr == peer->address.sin_addr.s_addr &&
+        _tp_subscribers[i].address.sin_port == peer->address.sin_port)
+    {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+sl_status_t tp_subscribe_update(uint8_t *args, uint16_t args_length, const wius_udp_peer_t *sender)
+{
+  sl_status_t status = SL_STATUS_OK;
+  uint8_t action = *args;
+  uint16_t port = *(uint16_t *)(args + 1);
+
+  wius_udp_peer_t peer = *sender;
+  if (port)
+    peer.address.sin_port = port;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  int index = _tp_subscribe_find(&peer);
+
+  switch (action)
+  {
+  case TP_SUBSCRIBE_REMOVE:
+    if (index >= 0)
+    {
+      _tp_subscribers[index] = _tp_subscribers[--_tp_num_subscribers];
+    }
+    break;
+  case TP_SUBSCRIBE_ADD:
+    if (index < 0)
+    {
+      if (_tp_num_subscribers < TP_SUBSCRIBER_MAX)
+        _tp_subscribers[_tp_num_subscribers++] = peer;
+      else
+        status = SL_STATUS_FULL;
+    }
+    break;
+  case TP_SUBSCRIBE_MULTICAST:
+  {
+    // Group addresses are 224.0.0.0/4, sent as they appear in the address (network order)
+    uint32_t group = 0;
+    if (args_length >= 7)
+      memcpy(&group, args + 3, 4);
+
+    if ((((const uint8_t *)&group)[0] & 0xF0) != 0xE0)
+    {
+      status = SL_STATUS_INVALID_PARAMETER;
+      break;
+    }
+
+    _tp_multicast_group = peer;
+    _tp_multicast_group.address.sin_addr.s_addr = group;
+    _tp_multicast_enabled = true;
+    break;
+  }
+  case TP_SUBSCRIBE_NO_MULTICAST:
+    _tp_multicast_enabled = false;
+    break;
+  case TP_SUBSCRIBE_CLEAR:
+    _tp_num_subscribers = 0;
+    break;
+  default:
+    status = SL_STATUS_INVALID_PARAMETER;
+    break;
+  }
+
+  __set_PRIMASK(primask);
+
+  if (SL_STATUS_OK != status)
+  {
+    LOG_W("Subscribe action %u failed: 0x%lx", action, status);
+    return status;
+  }
+
+  LOG_D("%u subscribers, multicast %s", _tp_num_subscribers, _tp_multicast_enabled ? "on" : "off");
+
+  return status;
+}
+
+size_t tp_subscribe_destinations(wius_udp_peer_t *peers, size_t max_peers)
+{
+  size_t count = 0;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  // The group reaches every member with a single transmission
+  if (_tp_multicast_enabled && max_peers)
+  {
+    peers[count++] = _tp_multicast_group;
+  }
+  else
+  {
+    for (; count < _tp_num_subscribers && count < max_peers; count++)
+    {
+      peers[count] = _tp_subscribers[count];
+    }
+  }
+
+  __set_PRIMASK(primask);
+
+  return count;
+}
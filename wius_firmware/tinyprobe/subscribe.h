@@ -0,0 +1,81 @@
+/**
+ * @file subscribe.h
+ *
+ * @brief Data stream subscribers for the TinyProbe
+ *
+ * Hosts register for the data stream with SUBSCRIBE commands. If a multicast group is set, every
+ * data packet is sent once to the group. Otherwise it is sent to every unicast subscriber, and
+ * without subscribers to the sender of the last command.
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_SUBSCRIBE_H_
+#define TP_SUBSCRIBE_H_
+
+#include "common.h"
+
+#include "wius/udp.h"
+
+/**
+ * @brief SUBSCRIBE command actions enumeration
+ *
+ */
+typedef enum tp_subscribe_action
+{
+  TP_SUBSCRIBE_REMOVE = 0,   /**< Remove the sender from the subscribers */
+  TP_SUBSCRIBE_ADD,          /**< Add the sender to the subscribers */
+  TP_SUBSCRIBE_MULTICAST,    /**< Send the stream to a multicast group */
+  TP_SUBSCRIBE_NO_MULTICAST, /**< Stop sending to the multicast group */
+  TP_SUBSCRIBE_CLEAR         /**< Remove all subscribers */
+} tp_subscribe_action_t;
+
+/**
+ * @brief Update the subscribers from a SUBSCRIBE command
+ *
+ * <table class="tg">
+ * <tbody>
+ *   <tr>
+ *     <th class="tg-1wig">Byte</th>
+ *     <th class="tg-0lax">0</th>
+ *     <th class="tg-0lax">1 - 2</th>
+ *     <th class="tg-0lax">3 - 6</th>
+ *   </tr>
+ *   <tr>
+ *     <td class="tg-1wig">Content</td>
+ *     <td class="tg-0lax">Action (@ref tp_subscribe_action_t)</td>
+ *     <td class="tg-0lax">Port (u16, 0 for the sender port)</td>
+ *     <td class="tg-0lax">Multicast group address (MULTICAST only)</td>
+ *   </tr>
+ * </tbody>
+ * </table>
+ *
+ * @param args: Command arguments
+ * @param args_length: Length of the command arguments
+ * @param sender: Sender of the command
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_FULL: Subscriber table is full
+ * @retval SL_STATUS_INVALID_PARAMETER: Unknown action or invalid group address
+ *
+ */
+sl_status_t tp_subscribe_update(uint8_t *args, uint16_t args_length, const wius_udp_peer_t *sender);
+
+/**
+ * @brief Get the destinations of the data stream
+ *
+ * @param peers: Array to copy the destinations to
+ * @param max_peers: Size of the array
+ *
+ * @return Number of destinations (0 if nobody subscribed)
+ *
+ * @note Only the multicast group is returned while it is set
+ *
+ */
+size_t tp_subscribe_destinations(wius_udp_peer_t *peers, size_t max_peers);
+
+#endif /* TP_SUBSCRIBE_H_ */
@@ -13,12 +13,22 @@
 #include "tp.h"
 
 #include "tinyprobe/command.h"
+#include "tinyprobe/program.h"
+#include "tinyprobe/profile.h"
 #include "tinyprobe/mux.h"
 #include "tinyprobe/fpga.h"
 #include "tinyprobe/afe.h"
 #include "tinyprobe/tx.h"
 #include "tinyprobe/power.h"
 #include "tinyprobe/buffer.h"
+#include "tinyprobe/retx.h"
+#include "tinyprobe/fec.h"
+#include "tinyprobe/pacing.h"
+#include "tinyprobe/credit.h"
+#include "tinyprobe/subscribe.h"
+#include "tinyprobe/perf.h"
+#include "tinyprobe/twt.h"
+#include "tinyprobe/link.h"
 #include "wius/power.h"
 #include "wius/wifi.h"
 #include "wius/spi.h"
@@ -26,6 +36,11 @@
 #include "wius/gpio_ulp.h"
 #include "wius/gpio_uulp.h"
 
+// A batch, the parity of its group and the next SPI transfer are held at once
+#if TP_UDP_TX_BATCH < 1 || TP_UDP_TX_BATCH + TP_FEC_MAX_M + 1 > TP_BUFFER_NUM - TP_RETX_CACHE_PACKETS
+#error "TP_UDP_TX_BATCH does not fit into the live data buffers"
+#endif
+
 #define TEST_MODE 0 // For testing acquisition code without confirmation from TinyProbe
 
 wius_gpio_uulp_t int_pin = WIUS_GPIO_UULP_INPUT(TP_GPIO_INT);
@@ -36,15 +51,38 @@ uint8_t wifi_rx_buffer[TP_WIFI_RX_BUFFER_SIZE] = {0};
 extern osEventFlagsId_t event_flags;
 osThreadId_t wifi_receive_thread_id;
 osThreadAttr_t wifi_rx_thread_attr = {
-    .name = "TP wifi receive",
-    .stack_size = 1024,
-    .priority = osPriorityLow,
+    .name = "TP control",
+    .stack_size = TP_CONTROL_THREAD_STACK,
+    .priority = TP_CONTROL_THREAD_PRIORITY,
 };
 
-// UDP socket over which communication happens
+/**
+ * @brief Command batch handed from the control thread to the main thread
+ *
+ */
+typedef struct
+{
+  uint32_t received;                    /**< Cycle counter at reception */
+  bool woken;                           /**< The M4 woke up from sleep for this batch */
+  uint32_t wake_cycles;                 /**< Cycle counter at that wakeup */
+  wius_udp_peer_t sender;               /**< Host that sent the batch */
+  uint8_t data[TP_WIFI_RX_BUFFER_SIZE]; /**< Received batch */
+} tp_command_packet_t;
+
+osMessageQueueId_t command_queue;
+
+// UDP sockets for commands (control port) and acquired data (data port)
 wius_udp_t tp_socket = {0};
-char client_ip[16] = {0};
-int client_port = 0;
+wius_udp_t tp_data_socket = {0};
+// Senders of the batch being executed, each only used by its own thread
+wius_udp_peer_t control_peer = {0}; // Control thread (immediate commands)
+wius_udp_peer_t client_peer = {0};  // Main thread (queued batches and the data stream)
+// Wakeup that brought the batch being executed, consumed by its first shot
+bool batch_woken = false;
+uint32_t batch_wake_cycles = 0;
+
+// Parity encoder of the data stream
+tp_fec_t tp_fec;
 
 // Buffer for storing acquired data
 tp_buffer_t tp_buf;
@@ -53,11 +91,23 @@ tp_buffer_t tp_buf;
 bool enable_udp_replies = false;
 uint16_t irq_shot_count = 0;
 uint16_t n_packs_to_read = 0;
+uint16_t frame_id = 0;
+int32_t tp_params[TP_COMMAND_NUM_PARAMS] = {0};
+volatile bool fpga_ready = false;
+uint32_t fpga_ready_polls = 0;
 
 void _tp_thread_wifi_receive(void *argument);
 void _tp_thread_transmit(void *argument);
 void _tp_int_handler(void);
-sl_status_t _tp_transmit_packages(void);
+void _tp_transmit_done(void *context);
+void _tp_transmit_parity(const wius_udp_frag_header_t *header, wius_udp_msg_t *msgs, size_t *num_msgs);
+sl_status_t _tp_transmit_batch(wius_udp_msg_t *msgs, size_t num_msgs);
+sl_status_t _tp_shot_length(uint32_t *length);
+bool _tp_transmit_take_credit(uint32_t length);
+sl_status_t _tp_transmit_packages(uint32_t length);
+const wius_udp_peer_t *_tp_command_sender(void);
+sl_status_t _tp_reopen_sockets(void);
+sl_status_t _tp_frontend_init(void);
 
 sl_status_t tp_init(void)
 {
@@ -65,6 +115,8 @@ sl_status_t tp_init(void)
 
   LOG_D("Initializing TinyProbe");
 
+  tp_profile_init();
+
   // Initialize SPI
   status = wius_spi_init(WIUS_SPI_INST_0);
   if (SL_STATUS_OK != status)
@@ -93,6 +145,16 @@ sl_status_t tp_init(void)
   tp_mux_init();
   tp_power_init();
 
+  // Restore stored command programs
+  tp_program_init();
+
+  // Packet buffer pool and parity encoder for the data path
+  tp_buffer_init(&tp_buf);
+  tp_fec_init(&tp_fec);
+  tp_fec_config(&tp_fec, TP_FEC_K, TP_FEC_M);
+  tp_pacing_init();
+  tp_credit_init();
+
   // Reset the FPGA
   wius_gpio_ulp_pin_set(reset_pin, false);
   delay_ms(10);
@@ -124,73 +186,8 @@ sl_status_t tp_init(void)
 
   LOG_D("Enabled power domains");
 
-#if !TEST_MODE
-  // Reset AFE and TX chip by writing a value to the dedicated register
-  CHECK_STATUS(tp_fpga_write_reg_safe(0x00000057, 10));
-  // 10 ms delay
-  delay_ms(10);
-  // Remove reset signals and set TR_EN to 0
-  CHECK_STATUS(tp_fpga_write_reg_safe(0x00000054, 10));
-
-  // Turn on active control of the AFE clk (power downs in between shots)
-  CHECK_STATUS(tp_fpga_write_reg_safe(0x4000ffff, 2));
-
-  LOG_D("Reset AFE and TX");
-#endif
-
-  // Select TX
-  tp_mux_select(TP_MUX_TX);
-  delay_ms(10);
-
-#if !TEST_MODE
-  // TX chip setup //
-  // Config TX chip
-  CHECK_STATUS(tp_tx_init());
-
-  // Turn on also active control of the TX BF clk
-  // (power downs in between TR_EN wake ups)
-//  CHECK_STATUS(tp_fpga_write_reg_safe(0x0000ffff, 2));
-  tp_fpga_write_reg_safe(0x0000ffff, 2);
-
-  LOG_D("Configured TX");
-#endif
-
-  // Switch the MUX to the AFE
-  tp_mux_select(TP_MUX_AFE);
-  delay_ms(10);
-
-#if !TEST_MODE
-  // AFE setup //
-  // Config AFE
-  CHECK_STATUS(tp_afe_init());
-  CHECK_STATUS(tp_afe_test_pattern(HALF_ZEROS_HALF_ONES));
-
-  // Set AFE Gain
-  CHECK_STATUS(tp_afe_write_reg_dtgc_safe(0xB5, 0));
-
-  LOG_D("Configured AFE");
-#endif
-
-  // Select the internal SPI slave module of the FPGA
-  tp_mux_select(TP_MUX_FPGA);
-  delay_ms(10);
-
-#if !TEST_MODE
-  //        // Enable AFE Fast Power down in between the shots
-  //        // (controlled by waveform_gen)
-  //        tp_fpga_write_reg_safe(0x00000050, 10);
-  //        // Enable AFE Global Power down in between the shots
-  //        // (controlled by waveform_gen)
-  //        tp_fpga_write_reg_safe(0x00000044, 10);
-
-  //            // Enable AFE Fast Power down and TR_EN signal duty cycling
-  //            // AFE Global power down is manually disabled
-  //            tp_fpga_write_reg_safe(0x00000010, 10);
-
-  // Enable automatic AFE Fast Power down and TR_EN signal duty cycling
-  // Enable AFE Global Power Down through pin
-  tp_fpga_write_reg_safe(0x00000030, 10);
-#endif
+  // The TX chip and the AFE lose their configuration whenever their rails are gated
+  CHECK_STATUS(_tp_frontend_init());
 
   // main_thread_id = osThreadNew(_tp_thread_main, NULL, &thread_attr);
   // if (main_thread_id == NULL)
@@ -212,6 +209,22 @@ sl_status_t tp_init(void)
   }
   LOG_D("Connected to WiFi");
 
+  // The data socket only transmits, commands never queue behind data
+  wius_udp_init(&tp_data_socket);
+  status = wius_udp_bind(&tp_data_socket, 0, TP_UDP_DATA_PORT);
+  if (SL_STATUS_OK != status)
+  {
+    LOG_E("Error connecting UDP data socket: 0x%lx", status);
+    return status;
+  }
+
+  command_queue = osMessageQueueNew(TP_COMMAND_QUEUE_SIZE, sizeof(tp_command_packet_t), NULL);
+  if (NULL == command_queue)
+  {
+    LOG_E("Error creating command queue");
+    return SL_STATUS_FAIL;
+  }
+
   wifi_receive_thread_id = osThreadNew(_tp_thread_wifi_receive, NULL, &wifi_rx_thread_attr);
   if (wifi_receive_thread_id == NULL)
   {
@@ -220,10 +233,15 @@ sl_status_t tp_init(void)
   }
   LOG_D("Wifi thread started");
 
-  CHECK_STATUS(wius_wifi_set_performance_profile(WIUS_PERF_PROFILE_LOWPOWER));
-  CHECK_STATUS(wius_power_m4_low());
+  CHECK_STATUS(tp_retx_init(&tp_buf, &tp_data_socket, _tp_command_sender));
+  CHECK_STATUS(tp_link_init(_tp_reopen_sockets));
+
+  CHECK_STATUS(tp_perf_init());
   LOG_D("Low power mode activated");
 
+  // Warm standby starts once initialized, not when the rails came up
+  tp_power_release();
+
   LOG_D("TinyProbe initialized");
 
   return status;
@@ -232,6 +250,7 @@ sl_status_t tp_init(void)
 void tp_main_thread(void)
 {
   sl_status_t status = SL_STATUS_OK;
+  static tp_command_packet_t packet;
 
   LOG_D("Started TinyProbe main thread");
 
@@ -239,25 +258,56 @@ void tp_main_thread(void)
 
   while (true)
   {
-    // Wait for a command to be received
-    if (!(osEventFlagsWait(event_flags, FLAG_CMD_RECEIVED, 0, osWaitForever) & FLAG_CMD_RECEIVED))
+    // Wait for a command to be received, leaving high performance and warm standby once idle for long enough
+    uint32_t timeout = tp_perf_timeout();
+    uint32_t power_timeout = tp_power_timeout();
+    if (power_timeout < timeout)
+      timeout = power_timeout;
+
+    // An expired timeout makes the get return at once with osErrorResource if the queue is empty
+    osStatus_t os_status = osMessageQueueGet(command_queue, &packet, NULL, timeout);
+    if (osErrorTimeout == os_status || (0 == timeout && osErrorResource == os_status))
     {
-      LOG_E("Error waiting for command received flags");
+      // Gate LVDS, high voltage and -5V once warm standby expired
+      tp_power_idle();
+
+      status = tp_perf_idle();
+      if (SL_STATUS_OK != status)
+      {
+        LOG_E("Error switching to idle WiFi profile: 0x%lx", status);
+        // Retry after another idle timeout instead of right away
+        tp_perf_release();
+      }
+      continue;
+    }
+    else if (osOK != os_status)
+    {
+      LOG_E("Error waiting for command");
       continue;
     }
 
+    tp_profile_record(TP_PROFILE_SLOT_CMD_QUEUED, packet.received);
+
+    // Replies and the data stream go to the host that sent this batch
+    client_peer = packet.sender;
+    batch_woken = packet.woken;
+    batch_wake_cycles = packet.wake_cycles;
+
+    // Interrupts raised before this batch are stale, WAIT_FPGA_IRQ only sees those of the batch
+    fpga_ready = false;
+
     led_red_set(true);
+    // Commands drive the FPGA with tight timing, the M4 must not sleep in between
+    wius_power_sleep_block();
 
     // Execute the command
-    status = tp_command_parse_and_execute(wifi_rx_buffer, TP_WIFI_RX_BUFFER_SIZE);
+    status = tp_command_parse_and_execute(packet.data, TP_WIFI_RX_BUFFER_SIZE);
     if (SL_STATUS_OK != status)
     {
       LOG_E("Error executing command: 0x%lx", status);
     }
 
-    // Set the command executed flag
-    osEventFlagsSet(event_flags, FLAG_CMD_EXECUTED);
-
+    wius_power_sleep_unblock();
     led_red_set(false);
   }
 }
@@ -267,6 +317,7 @@ void _tp_thread_wifi_receive(void *argument)
   // listens for incoming UDP packets
   (void)argument;
   sl_status_t status = SL_STATUS_OK;
+  static tp_command_packet_t packet;
 
   LOG_D("Started TinyProbe WiFi receive thread");
 
@@ -285,34 +336,52 @@ void _tp_thread_wifi_receive(void *argument)
   {
     memset(wifi_rx_buffer, 0, TP_WIFI_RX_BUFFER_SIZE);
 
-    status = wius_udp_receivefrom(&tp_socket, wifi_rx_buffer, TP_WIFI_RX_BUFFER_SIZE, &received_len,
-                                  client_ip, sizeof(client_ip), &client_port, 0);
+    status = wius_udp_receivefrom_peer(&tp_socket, wifi_rx_buffer, TP_WIFI_RX_BUFFER_SIZE, &received_len,
+                                       &control_peer, 0);
     if (SL_STATUS_OK != status)
     {
+      // The link thread re-opens the socket once reconnected, do not spin on the dead one
+      if (!wius_wifi_is_connected() || !tp_socket.connected)
+      {
+        delay_ms(TP_LINK_PERIOD_MS);
+        continue;
+      }
+
       LOG_E("Error receiving UDP packet: 0x%lx", status);
       continue;
     }
 
-    LOG_D("Received UDP packet from %s:%d", client_ip, client_port);
+    uint32_t received = tp_profile_start();
+
+    // Stamp the wakeup now, a queued batch may run after other wakeups
+    uint32_t wake_cycles = 0;
+    bool woken = wius_power_take_wakeup(&wake_cycles);
+
+    LOG_D("Received UDP packet from " WIUS_UDP_PEER_FMT, WIUS_UDP_PEER_ARGS(&control_peer));
     // LOG_D("Packet: '%s'", wifi_rx_buffer);
 
-    // Parse the command
-    if (tp_command_parse(wifi_rx_buffer, TP_WIFI_RX_BUFFER_SIZE) == NULL)
+    // Short control commands are answered right away, even during an acquisition
+    bool executed = false;
+    status = tp_command_execute_immediate(wifi_rx_buffer, received_len, &executed);
+    if (executed)
     {
-      LOG_E("Invalid command, skipping");
+      tp_profile_record(TP_PROFILE_SLOT_CMD_IMMEDIATE, received);
+      if (SL_STATUS_OK != status)
+      {
+        LOG_E("Error executing command: 0x%lx", status);
+      }
       continue;
     }
 
-    LOG_D("Valid command");
-
-    // Set the command received flag
-    osEventFlagsSet(event_flags, FLAG_CMD_RECEIVED);
-
-    // Wait for the command to be executed
-    if (!(osEventFlagsWait(event_flags, FLAG_CMD_EXECUTED, 0, osWaitForever) & FLAG_CMD_EXECUTED))
+    // Everything else is executed in order by the main thread
+    packet.received = received;
+    packet.woken = woken;
+    packet.wake_cycles = wake_cycles;
+    packet.sender = control_peer;
+    memcpy(packet.data, wifi_rx_buffer, TP_WIFI_RX_BUFFER_SIZE);
+    if (osOK != osMessageQueuePut(command_queue, &packet, 0, 0))
     {
-      LOG_E("Error waiting for command executed flag");
-      continue;
+      LOG_W("Command queue full, skipping");
     }
   }
 }
@@ -329,7 +398,7 @@ sl_status_t tp_ping(uint8_t *args, uint16_t args_length)
   // TODO: See if this is OK
   char reply[32] = {0};
   snprintf(reply, sizeof(reply), "TinyProbe %d", TP_PROBE_ID);
-  CHECK_STATUS(wius_udp_sendto(&tp_socket, (const uint8_t *)reply, strlen(reply), client_ip, client_port));
+  CHECK_STATUS(wius_udp_sendto_peer(&tp_socket, (const uint8_t *)reply, strlen(reply), _tp_command_sender()));
 
   LOG_D("Done");
 
@@ -480,8 +549,6 @@ sl_status_t tp_ctrl_pwr(uint8_t *args, uint16_t args_length)
   return SL_STATUS_OK;
 }
 
-volatile bool fpga_ready = false;
-
 sl_status_t tp_trigger_shot(uint8_t *args, uint16_t args_length)
 {
   LOG_D("Executing");
@@ -495,11 +562,38 @@ sl_status_t tp_trigger_shot(uint8_t *args, uint16_t args_length)
   uint8_t usdivten = *(uint8_t *)(args + 4);
   uint8_t usfifo = *(uint8_t *)(args + 5);
 
-  LOG_D("Triggering %lu shots with %u packets to read", n_shots, n_packs_to_read);
+#if !TP_FPGA_FIFO_LEVEL
+  // Without the fill level the packet count is the only source of the shot length
+  if (0 == n_packs_to_read)
+  {
+    LOG_W("No packets to read");
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+#endif
+
+  // No packet count drains the FIFO by its fill level
+  if (n_packs_to_read)
+    LOG_D("Triggering %lu shots with %u packets to read", n_shots, n_packs_to_read);
+  else
+    LOG_D("Triggering %lu shots, draining the FIFO", n_shots);
+
+  // Latency from the wakeup that brought this command to the first shot on air
+  uint32_t wake_cycles = batch_wake_cycles;
+  bool woken = batch_woken;
+  batch_woken = false;
+
+  // The load is unknown when draining the FIFO, large loads saturate
+  uint64_t load = (uint64_t)n_shots * n_packs_to_read * TP_UDP_PACKET_SIZE;
+  CHECK_STATUS(tp_perf_acquire(load > UINT32_MAX ? UINT32_MAX : (uint32_t)load));
+  LOG_D("Acquisition mode activated");
 
-  CHECK_STATUS(wius_power_m4_high());
-  CHECK_STATUS(wius_wifi_set_performance_profile(WIUS_PERF_PROFILE_HIGHSPEED));
-  LOG_D("High speed mode activated");
+  // Bring gated domains back up and configure the chips on them again, counts into the time to
+  // first shot
+  if (tp_power_acquire())
+    CHECK_STATUS(_tp_frontend_init());
+
+  // Follow the link state, FEC must not change during a shot
+  tp_link_adapt(&tp_fec);
 
   uint32_t start_time = 0;
   uint32_t end_time = 0;
@@ -508,11 +602,13 @@ sl_status_t tp_trigger_shot(uint8_t *args, uint16_t args_length)
   CHECK_STATUS(tp_fpga_empty_tx());
 
   irq_shot_count = 0;
+  fpga_ready_polls = 0;
 
   start_time = time_ms();
 
   CHECK_STATUS(tp_fpga_send_start());
 
+  bool first_sent = false;
   for (uint32_t i = 0; i < n_shots; i++)
   {
 // TODO: Is this handled correctly?
@@ -540,10 +636,46 @@ sl_status_t tp_trigger_shot(uint8_t *args, uint16_t args_length)
     // Wait 24 clock cycles of 10 MHz clock
     // It is worst case maximum time needed for the internal IP
     // To read the data from the Core FIFO and push it into the SPI TX buffer.
+#if TP_FPGA_READY_HANDSHAKE
+    // Start reading as soon as the bitstream reports the data in the SPI TX buffer
+    uint32_t ready_start = tp_profile_start();
+    uint32_t ready_polls = 0;
+    status = tp_fpga_wait_tx_ready(TP_FPGA_READY_POLLS, &ready_polls);
+    if (SL_STATUS_TIMEOUT == status)
+    {
+      // Fall back to the worst case wait and read anyway
+      LOG_W("Shot %lu not ready after %lu polls", i, ready_polls - 1);
+      delay_ns(2400);
+    }
+    else
+    {
+      CHECK_STATUS(status);
+      tp_profile_record(TP_PROFILE_SLOT_FPGA_READY, ready_start);
+    }
+    fpga_ready_polls += ready_polls;
+#else
     delay_ns(2400);
+#endif
+
+    uint32_t length = 0;
+    CHECK_STATUS(_tp_shot_length(&length));
+
+    // With TP_TWT_ALIGN, hold the shot back to the next TWT service period if it does not fit into this one
+    tp_twt_align((length + TP_UDP_PACKET_SIZE - 1) / TP_UDP_PACKET_SIZE);
 
     // TODO: Check implementation speed
-    _tp_transmit_packages();
+    if (0 == length)
+      LOG_W("Shot %lu is empty", i);
+    else if (!_tp_transmit_take_credit(length))
+      LOG_D("Shot %lu dropped, not enough credit", i);
+    else if (SL_STATUS_OK == _tp_transmit_packages(length) && !first_sent)
+    {
+      // Time to first shot counts the first shot that actually went out
+      first_sent = true;
+      tp_power_first_shot();
+      if (woken)
+        tp_profile_record(TP_PROFILE_SLOT_WAKE_TO_DATA, wake_cycles);
+    }
 
     CHECK_STATUS(tp_fpga_reset_multififo());
   }
@@ -552,23 +684,600 @@ sl_status_t tp_trigger_shot(uint8_t *args, uint16_t args_length)
 
   LOG_D("Shot time:  %lu ms", end_time - start_time);
   LOG_D("Shot count: %u", irq_shot_count);
+  LOG_D("Ready polls: %lu", fpga_ready_polls);
 
-  CHECK_STATUS(wius_wifi_set_performance_profile(WIUS_PERF_PROFILE_LOWPOWER));
-  CHECK_STATUS(wius_power_m4_low());
-  LOG_D("Low power mode activated");
+  // The WiFi profile, core clock and power domains are kept until no shot was triggered for a while
+  tp_perf_release();
+  tp_power_release();
 
   LOG_D("Done");
 
   return SL_STATUS_OK;
 }
 
-sl_status_t _tp_transmit_packages(void)
+sl_status_t tp_wait_fpga_irq(uint8_t *args, uint16_t args_length)
 {
+  LOG_D("Executing");
+
+  (void)args_length;
+
+  uint32_t timeout_ms = *(uint32_t *)args;
+  uint32_t start_time = time_ms();
+
+  // The interrupt is latched since the start of the batch (or the last wait or shot), so one
+  // raised by a preceding command of the batch is not lost. Busy wait like the shot loop does,
+  // so the next command starts right after the interrupt.
+  while (!fpga_ready)
+  {
+    if (time_ms() - start_time >= timeout_ms)
+    {
+      LOG_W("No FPGA interrupt within %lu ms", timeout_ms);
+      return SL_STATUS_TIMEOUT;
+    }
+  }
+  fpga_ready = false;
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t tp_set_param(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  (void)args_length;
+
+  uint8_t index = *args;
+  bool increment = *(bool *)(args + 1);
+  int32_t value = *(int32_t *)(args + 2);
+
+  if (index >= TP_COMMAND_NUM_PARAMS)
+  {
+    LOG_W("%u is invalid parameter (0 - %u)", index, TP_COMMAND_NUM_PARAMS - 1);
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  if (increment)
+    tp_params[index] += value;
+  else
+    tp_params[index] = value;
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t tp_write_param(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  (void)args_length;
   sl_status_t status = SL_STATUS_OK;
 
-  tp_buffer_init(&tp_buf);
+  uint8_t index = *args;
+  tp_param_target_t target = *(args + 1);
+  uint16_t reg_addr = *(uint16_t *)(args + 2);
+
+  if (index >= TP_COMMAND_NUM_PARAMS)
+  {
+    LOG_W("%u is invalid parameter (0 - %u)", index, TP_COMMAND_NUM_PARAMS - 1);
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  switch (target)
+  {
+  case TP_PARAM_TARGET_FPGA:
+    CHECK_STATUS(tp_fpga_write_reg_safe(tp_params[index], reg_addr));
+    break;
+  case TP_PARAM_TARGET_AFE:
+    CHECK_STATUS(tp_afe_write_reg(reg_addr, tp_params[index]));
+    break;
+  case TP_PARAM_TARGET_AFE_DTGC:
+    CHECK_STATUS(tp_afe_write_reg_dtgc(reg_addr, tp_params[index]));
+    break;
+  case TP_PARAM_TARGET_TX:
+    CHECK_STATUS(tp_tx_write_reg(reg_addr, tp_params[index]));
+    break;
+  default:
+    LOG_W("Unknown parameter target %u", target);
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t tp_get_stats(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  (void)args_length;
+  sl_status_t status = SL_STATUS_OK;
+
+  uint8_t first = *args;
+  uint8_t count = *(args + 1);
+  bool reset = *(bool *)(args + 2);
+
+  // Reply: profiling clock [uint32_t], first slot [uint8_t], slot count [uint8_t], statistics
+  static uint8_t reply[TP_WIFI_RX_BUFFER_SIZE];
+  const size_t header_length = 6;
+  uint8_t max_count = (sizeof(reply) - header_length) / sizeof(tp_profile_stats_t);
+
+  if (count > max_count)
+    count = max_count;
+  if (first >= TP_PROFILE_SLOT_MAX)
+    count = 0;
+  else if (first + count > TP_PROFILE_SLOT_MAX)
+    count = TP_PROFILE_SLOT_MAX - first;
+
+  uint32_t profile_clock = TP_PROFILE_CLOCK_HZ;
+  memcpy(reply, &profile_clock, 4);
+  reply[4] = first;
+  reply[5] = count;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    tp_profile_stats_t stats;
+    tp_profile_get(first + i, &stats);
+    memcpy(&reply[header_length + i * sizeof(stats)], &stats, sizeof(stats));
+  }
+
+  CHECK_STATUS(wius_udp_sendto_peer(&tp_socket, reply, header_length + count * sizeof(tp_profile_stats_t),
+                                    _tp_command_sender()));
+
+  if (reset)
+    tp_profile_reset();
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t tp_set_fec(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  (void)args_length;
+  sl_status_t status = SL_STATUS_OK;
+
+  uint8_t k = *args;
+  uint8_t m = *(args + 1);
+  uint16_t bench_groups = *(uint16_t *)(args + 2);
+
+  CHECK_STATUS(tp_fec_config(&tp_fec, k, m));
+
+  // Benchmark the encoder on synthetic packets, results go to the FEC_ENCODE profiling slot
+  if (bench_groups && tp_fec_enabled(&tp_fec))
+  {
+    static uint8_t payload[TP_UDP_PACKET_SIZE];
+    uint64_t cycles = 0;
+
+    for (size_t n = 0; n < sizeof(payload); n++)
+      payload[n] = n * 31 + 7;
+
+    for (uint32_t i = 0; i < (uint32_t)bench_groups * k; i++)
+    {
+      payload[i % sizeof(payload)]++;
 
-  tp_buffer_slot_t *slot_spi = tp_buffer_claim_writing(&tp_buf);
+      uint32_t start = tp_profile_start();
+      if (tp_fec_add(&tp_fec, payload, sizeof(payload)))
+        tp_fec_reset(&tp_fec);
+      cycles += DWT->CYCCNT - start;
+      tp_profile_record(TP_PROFILE_SLOT_FEC_ENCODE, start);
+    }
+
+    uint64_t bytes = (uint64_t)bench_groups * k * sizeof(payload);
+    LOG_D("FEC K=%u M=%u: %lu kB/s", k, m, (uint32_t)(bytes * (SystemCoreClock / 1000) / (cycles ? cycles : 1)));
+
+    tp_fec_reset(&tp_fec);
+  }
+
+  LOG_D("Done");
+
+  return status;
+}
+
+sl_status_t tp_pacing(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  (void)args_length;
+  sl_status_t status = SL_STATUS_OK;
+
+  uint8_t mode = *args;
+  uint32_t rate = *(uint32_t *)(args + 1);
+
+  // Modes past the last one only report the statistics
+  if (mode < TP_PACING_MODE_MAX)
+    CHECK_STATUS(tp_pacing_config(mode, rate));
+
+  // Reply: pacing statistics
+  tp_pacing_stats_t stats;
+  tp_pacing_get(&stats);
+
+  CHECK_STATUS(wius_udp_sendto_peer(&tp_socket, (uint8_t *)&stats, sizeof(stats), _tp_command_sender()));
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t tp_credit(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  (void)args_length;
+  sl_status_t status = SL_STATUS_OK;
+
+  uint8_t mode = *args;
+  uint8_t unit = *(args + 1);
+  uint32_t amount = *(uint32_t *)(args + 2);
+
+  // Modes past the last one only grant credit
+  if (mode < TP_CREDIT_MODE_MAX)
+    CHECK_STATUS(tp_credit_config(mode, unit));
+
+  if (amount)
+    tp_credit_grant(amount);
+
+  // Reply: flow control status
+  if (enable_udp_replies)
+  {
+    tp_credit_stats_t stats;
+    tp_credit_get(&stats);
+
+    CHECK_STATUS(wius_udp_sendto_peer(&tp_socket, (uint8_t *)&stats, sizeof(stats), _tp_command_sender()));
+  }
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t tp_subscribe(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  sl_status_t status = SL_STATUS_OK;
+
+  CHECK_STATUS(tp_subscribe_update(args, args_length, _tp_command_sender()));
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t tp_twt(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  (void)args_length;
+  sl_status_t status = SL_STATUS_OK;
+
+  uint8_t enable = *args;
+  uint32_t period_us = *(uint32_t *)(args + 1);
+  uint16_t packets = *(uint16_t *)(args + 5);
+
+  // Default to the packets per shot of the last trigger
+  if (0 == packets)
+    packets = n_packs_to_read;
+  if (0 == packets)
+  {
+    LOG_W("Packets per shot unknown while draining the FIFO");
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  CHECK_STATUS(tp_twt_config(enable, period_us, packets));
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t tp_link(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  (void)args_length;
+  sl_status_t status = SL_STATUS_OK;
+
+  // Values past 1 only report the statistics
+  uint8_t adapt = *args;
+  if (adapt <= 1)
+    tp_link_set_adapt(adapt);
+
+  // Reply: link statistics
+  tp_link_stats_t stats;
+  tp_link_get(&stats);
+
+  CHECK_STATUS(wius_udp_sendto_peer(&tp_socket, (uint8_t *)&stats, sizeof(stats), _tp_command_sender()));
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+sl_status_t tp_standby(uint8_t *args, uint16_t args_length)
+{
+  LOG_D("Executing");
+
+  sl_status_t status = SL_STATUS_OK;
+
+  // Arguments: set [uint8_t], warm standby time [uint32_t], settle times [uint16_t per domain] (optional)
+  if (*args)
+  {
+    if (args_length < 5)
+      return SL_STATUS_INVALID_PARAMETER;
+
+    uint32_t warm_ms = 0;
+    memcpy(&warm_ms, args + 1, 4);
+
+    uint16_t settle_ms[TP_POWER_DOMAIN_MAX];
+    bool has_settle = args_length >= 5 + sizeof(settle_ms);
+    if (has_settle)
+      memcpy(settle_ms, args + 5, sizeof(settle_ms));
+
+    tp_power_config(warm_ms, has_settle ? settle_ms : NULL);
+  }
+
+  // Reply: power statistics
+  tp_power_stats_t stats;
+  tp_power_get(&stats);
+
+  CHECK_STATUS(wius_udp_sendto_peer(&tp_socket, (uint8_t *)&stats, sizeof(stats), _tp_command_sender()));
+
+  LOG_D("Done");
+
+  return SL_STATUS_OK;
+}
+
+const wius_udp_peer_t *_tp_command_sender(void)
+{
+  // Immediate commands run on the control thread, everything else on the main thread
+  if (osThreadGetId() == wifi_receive_thread_id)
+    return &control_peer;
+
+  return &client_peer;
+}
+
+sl_status_t _tp_reopen_sockets(void)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  // Senders are held off by the transmit queue lock, the control thread is released from its
+  // receive on the closed socket and continues on the new one
+  CHECK_STATUS(wius_udp_reopen(&tp_data_socket));
+  CHECK_STATUS(wius_udp_reopen(&tp_socket));
+
+  LOG_D("Sockets re-opened");
+
+  return status;
+}
+
+sl_status_t _tp_frontend_init(void)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+#if !TEST_MODE
+  // Reset AFE and TX chip by writing a value to the dedicated register
+  CHECK_STATUS(tp_fpga_write_reg_safe(0x00000057, 10));
+  // 10 ms delay
+  delay_ms(10);
+  // Remove reset signals and set TR_EN to 0
+  CHECK_STATUS(tp_fpga_write_reg_safe(0x00000054, 10));
+
+  // Turn on active control of the AFE clk (power downs in between shots)
+  CHECK_STATUS(tp_fpga_write_reg_safe(0x4000ffff, 2));
+
+  LOG_D("Reset AFE and TX");
+#endif
+
+  // Select TX
+  tp_mux_select(TP_MUX_TX);
+  delay_ms(10);
+
+#if !TEST_MODE
+  // TX chip setup //
+  // Config TX chip
+  CHECK_STATUS(tp_tx_init());
+
+  // Turn on also active control of the TX BF clk
+  // (power downs in between TR_EN wake ups)
+//  CHECK_STATUS(tp_fpga_write_reg_safe(0x0000ffff, 2));
+  tp_fpga_write_reg_safe(0x0000ffff, 2);
+
+  LOG_D("Configured TX");
+#endif
+
+  // Switch the MUX to the AFE
+  tp_mux_select(TP_MUX_AFE);
+  delay_ms(10);
+
+#if !TEST_MODE
+  // AFE setup //
+  // Config AFE
+  CHECK_STATUS(tp_afe_init());
+  CHECK_STATUS(tp_afe_test_pattern(HALF_ZEROS_HALF_ONES));
+
+  // Set AFE Gain
+  CHECK_STATUS(tp_afe_write_reg_dtgc_safe(0xB5, 0));
+
+  LOG_D("Configured AFE");
+#endif
+
+  // Select the internal SPI slave module of the FPGA
+  tp_mux_select(TP_MUX_FPGA);
+  delay_ms(10);
+
+#if !TEST_MODE
+  //        // Enable AFE Fast Power down in between the shots
+  //        // (controlled by waveform_gen)
+  //        tp_fpga_write_reg_safe(0x00000050, 10);
+  //        // Enable AFE Global Power down in between the shots
+  //        // (controlled by waveform_gen)
+  //        tp_fpga_write_reg_safe(0x00000044, 10);
+
+  //            // Enable AFE Fast Power down and TR_EN signal duty cycling
+  //            // AFE Global power down is manually disabled
+  //            tp_fpga_write_reg_safe(0x00000010, 10);
+
+  // Enable automatic AFE Fast Power down and TR_EN signal duty cycling
+  // Enable AFE Global Power Down through pin
+  tp_fpga_write_reg_safe(0x00000030, 10);
+#endif
+
+  return status;
+}
+
+void _tp_transmit_done(void *context)
+{
+  tp_buffer_return(&tp_buf, (tp_buffer_slot_t *)context, true);
+}
+
+void _tp_transmit_parity(const wius_udp_frag_header_t *header, wius_udp_msg_t *msgs, size_t *num_msgs)
+{
+  // Parity packets refer to the first data packet of their group
+  wius_udp_frag_header_t parity_header = *header;
+  parity_header.index = header->index - tp_fec.count;
+  parity_header.flags |= WIUS_UDP_FRAG_FLAG_PARITY;
+
+  tp_fec_header_t fec_header = {
+      .parity = 0,
+      .count = tp_fec.count,
+      .k = tp_fec.k,
+      .m = tp_fec.m,
+  };
+
+  for (; fec_header.parity < tp_fec.m; fec_header.parity++)
+  {
+    tp_buffer_slot_t *slot = tp_buffer_claim_writing(&tp_buf, tp_fec.length);
+    if (NULL == slot)
+    {
+      LOG_W("Error claiming buffer for parity");
+      break;
+    }
+
+    memcpy(tp_buffer_put(slot, tp_fec.length), tp_fec.parity[fec_header.parity], tp_fec.length);
+    memcpy(tp_buffer_push(slot, sizeof(fec_header)), &fec_header, sizeof(fec_header));
+    memcpy(tp_buffer_push(slot, sizeof(parity_header)), &parity_header, sizeof(parity_header));
+
+    msgs[*num_msgs].data = tp_buffer_packet(slot);
+    msgs[*num_msgs].data_len = slot->length;
+    msgs[*num_msgs].done = _tp_transmit_done;
+    msgs[*num_msgs].context = slot;
+    (*num_msgs)++;
+  }
+
+  tp_fec_reset(&tp_fec);
+}
+
+sl_status_t _tp_transmit_batch(wius_udp_msg_t *msgs, size_t num_msgs)
+{
+  sl_status_t status = SL_STATUS_OK;
+  size_t bytes = 0;
+
+  // Without subscribers the stream goes to the sender of the last command
+  wius_udp_peer_t peers[TP_SUBSCRIBER_MAX];
+  size_t num_peers = tp_subscribe_destinations(peers, TP_SUBSCRIBER_MAX);
+  if (0 == num_peers)
+  {
+    peers[num_peers++] = client_peer;
+  }
+
+  for (size_t m = 0; m < num_msgs; m++)
+  {
+    bytes += msgs[m].data_len;
+
+    // Every destination completes (and releases) its own reference
+    for (size_t p = 1; p < num_peers; p++)
+    {
+      tp_buffer_ref((tp_buffer_slot_t *)msgs[m].context);
+    }
+  }
+
+  // Shape the stream so bursts do not overflow the NWP transmit queue
+  tp_pacing_wait(bytes * num_peers);
+
+  for (size_t p = 0; p < num_peers; p++)
+  {
+    size_t num_sent = 0;
+    size_t sent_bytes = bytes;
+
+    uint32_t send_start = tp_profile_start();
+    sl_status_t send_status = wius_udp_sendmmsg_peer(&tp_data_socket, msgs, num_msgs, &peers[p], &num_sent,
+                                                     TP_UDP_TX_TIMEOUT_MS);
+    uint32_t send_cycles = DWT->CYCCNT - send_start;
+    tp_profile_record(TP_PROFILE_SLOT_UDP_SEND, send_start);
+    if (SL_STATUS_OK != send_status)
+    {
+      LOG_W("Error transmitting %u packets to " WIUS_UDP_PEER_FMT, (unsigned)(num_msgs - num_sent),
+            WIUS_UDP_PEER_ARGS(&peers[p]));
+      if (SL_STATUS_OK == status)
+        status = send_status;
+    }
+
+    for (size_t m = num_sent; m < num_msgs; m++)
+    {
+      sent_bytes -= msgs[m].data_len;
+    }
+    tp_pacing_feedback(sent_bytes, send_cycles, send_status, wius_udp_tx_pending());
+
+    // Buffers of packets not accepted still belong to us
+    for (size_t m = num_sent; m < num_msgs; m++)
+    {
+      tp_buffer_return(&tp_buf, (tp_buffer_slot_t *)msgs[m].context, true);
+    }
+  }
+
+  return status;
+}
+
+sl_status_t _tp_shot_length(uint32_t *length)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  if (n_packs_to_read || !TP_FPGA_FIFO_LEVEL)
+  {
+    *length = (uint32_t)n_packs_to_read * TP_UDP_PACKET_SIZE;
+    return status;
+  }
+
+  // Exactly what the shot produced, the frame header counts fragments in 16 bits
+  CHECK_STATUS(tp_fpga_read_fifo_level(length));
+  if (*length > (uint32_t)UINT16_MAX * TP_UDP_PACKET_SIZE)
+    *length = (uint32_t)UINT16_MAX * TP_UDP_PACKET_SIZE;
+
+  return status;
+}
+
+bool _tp_transmit_take_credit(uint32_t length)
+{
+  uint32_t packets = (length + TP_UDP_PACKET_SIZE - 1) / TP_UDP_PACKET_SIZE;
+
+  // A shot costs all of its data and parity packets
+  uint32_t parity = 0;
+  if (tp_fec_enabled(&tp_fec))
+    parity = (packets + tp_fec.k - 1) / tp_fec.k * tp_fec.m;
+
+  uint32_t datagrams = packets + parity;
+  uint32_t bytes = length + packets * sizeof(wius_udp_frag_header_t) +
+                   parity * (TP_UDP_PACKET_SIZE + sizeof(wius_udp_frag_header_t) + sizeof(tp_fec_header_t));
+
+  return tp_credit_take(datagrams, bytes);
+}
+
+sl_status_t _tp_transmit_packages(uint32_t length)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  // The last packet only carries the rest of the shot
+  uint16_t packets = (length + TP_UDP_PACKET_SIZE - 1) / TP_UDP_PACKET_SIZE;
+  uint32_t remaining = length;
+  size_t xfer = (remaining < TP_UDP_PACKET_SIZE ? remaining : TP_UDP_PACKET_SIZE) + 2;
+
+  tp_buffer_slot_t *slot_spi = tp_buffer_claim_writing(&tp_buf, xfer);
   if (NULL == slot_spi)
   {
     LOG_W("Timeout claiming initial buffer for write");
@@ -579,60 +1288,137 @@ sl_status_t _tp_transmit_packages(void)
   tx_buf[0] = SP_RD_FIFO;
   tx_buf[1] = SPI_DUMMY_ADDR;
 
-  //  CHECK_STATUS(tp_fpga_read_fifo(tx_dummy, slot_spi->data, TP_UDP_PACKET_SIZE + 2, false));
-  status = wius_spi_xfer(WIUS_SPI_INST_0, tx_buf, slot_spi->data, TP_UDP_PACKET_SIZE + 2, false);
-//  status = wius_spi_recv(WIUS_SPI_INST_0, slot_spi->data, TP_UDP_PACKET_SIZE + 2, false);
+  // The SPI DMA lands directly behind the headroom of the slot
+  status = wius_spi_xfer(WIUS_SPI_INST_0, tx_buf, tp_buffer_put(slot_spi, xfer), xfer, false);
   if (SL_STATUS_OK != status)
   {
     LOG_E("Error starting initial SPI recv: 0x%04X", status);
+    tp_buffer_return(&tp_buf, slot_spi, true);
     return status;
   }
 
-  for (uint16_t i = 0; i < n_packs_to_read; i++)
+  // Retransmissions wait until the shot is sent
+  tp_retx_pause(true);
+  tp_fec_reset(&tp_fec);
+  tp_pacing_shot_start();
+
+  // Every shot is sent as one frame, each packet being a fragment of it
+  uint16_t filled = 0;
+  wius_udp_frag_header_t header = {
+      .index = 0,
+      .frame = frame_id++,
+      .count = packets,
+      .flags = 0,
+      .length = length,
+  };
+
+  for (uint16_t i = 0; i < packets; i++)
   {
-    CHECK_STATUS(wius_spi_await(WIUS_SPI_INST_0));
-    // delay_ns(120000);
-
-    slot_spi->length = TP_UDP_PACKET_SIZE + 2;
+    status = wius_spi_await(WIUS_SPI_INST_0);
+    if (SL_STATUS_OK != status)
+    {
+      LOG_E("Error awaiting SPI recv: 0x%04X", status);
+      tp_buffer_return(&tp_buf, slot_spi, true);
+      break;
+    }
 
+    // Drop the bytes clocked out during the FIFO read command
+    tp_buffer_pull(slot_spi, 2);
     tp_buffer_return(&tp_buf, slot_spi, false);
+    remaining -= xfer - 2;
+    filled++;
 
-    if (i != n_packs_to_read - 1)
+    if (i != packets - 1)
     {
-      slot_spi = tp_buffer_claim_writing(&tp_buf);
+      xfer = (remaining < TP_UDP_PACKET_SIZE ? remaining : TP_UDP_PACKET_SIZE) + 2;
+      slot_spi = tp_buffer_claim_writing(&tp_buf, xfer);
       if (NULL == slot_spi)
       {
         LOG_E("Error claiming buffer for write");
-        return SL_STATUS_FAIL;
+        status = SL_STATUS_FAIL;
+        break;
       }
 
-      // CHECK_STATUS(tp_fpga_read_fifo(tx_dummy, slot_spi->data, TP_UDP_PACKET_SIZE + 2, false));
-//      status = wius_spi0_xfer_cont(tx_buf, slot_spi->data, TP_UDP_PACKET_SIZE + 2);
-      status = wius_spi_xfer(WIUS_SPI_INST_0, tx_buf, slot_spi->data, TP_UDP_PACKET_SIZE + 2, false);
-//      status = wius_spi_recv(WIUS_SPI_INST_0, slot_spi->data, TP_UDP_PACKET_SIZE + 2, false);
+      status = wius_spi_xfer(WIUS_SPI_INST_0, tx_buf, tp_buffer_put(slot_spi, xfer), xfer, false);
       if (SL_STATUS_OK != status)
       {
         LOG_E("Error starting SPI recv: 0x%04X", status);
-        return status;
+        tp_buffer_return(&tp_buf, slot_spi, true);
+        break;
+      }
+    }
+
+    // The next SPI read runs while a batch is sent, packets are collected until the batch is full
+    if (filled < TP_UDP_TX_BATCH && i != packets - 1)
+      continue;
+    filled = 0;
+
+    // Hand all filled packets over to the network processor in one batch
+    static wius_udp_msg_t msgs[TP_BUFFER_NUM];
+    size_t num_msgs = 0;
+    tp_buffer_slot_t *slot_udp;
+    while (NULL != (slot_udp = tp_buffer_claim_reading(&tp_buf)))
+    {
+      // Prepend the packet with its fragment header
+      memcpy(tp_buffer_push(slot_udp, sizeof(header)), &header, sizeof(header));
+      header.index++;
+
+      tp_retx_store(slot_udp);
+
+      // The slot is discarded by _tp_transmit_done once the packet is handed over
+      msgs[num_msgs].data = tp_buffer_packet(slot_udp);
+      msgs[num_msgs].data_len = slot_udp->length;
+      msgs[num_msgs].done = _tp_transmit_done;
+      msgs[num_msgs].context = slot_udp;
+      num_msgs++;
+
+      if (tp_fec_enabled(&tp_fec))
+      {
+        uint32_t fec_start = tp_profile_start();
+        bool group_done = tp_fec_add(&tp_fec, tp_buffer_packet(slot_udp) + sizeof(header),
+                                     slot_udp->length - sizeof(header));
+        tp_profile_record(TP_PROFILE_SLOT_FEC_ENCODE, fec_start);
+
+        if (group_done)
+          _tp_transmit_parity(&header, msgs, &num_msgs);
       }
     }
 
-    tp_buffer_slot_t *slot_udp = tp_buffer_claim_reading(&tp_buf);
-    if (NULL == slot_udp)
+    if (0 == num_msgs)
     {
       LOG_E("Error claiming buffer for read");
-      return SL_STATUS_FAIL;
+      status = SL_STATUS_FAIL;
+      break;
     }
 
-    // Prepend the packet with the shot number
-    memcpy(slot_udp->data, &i, 2);
+    status = _tp_transmit_batch(msgs, num_msgs);
+  }
 
-    status = wius_udp_sendto(&tp_socket, slot_udp->data, TP_UDP_PACKET_SIZE + 2, client_ip, client_port);
-    if (SL_STATUS_OK != status)
-      LOG_W("Error transmitting packet");
+  // Protect the last, incomplete group
+  if (SL_STATUS_OK == status && tp_fec_enabled(&tp_fec) && tp_fec.count > 0)
+  {
+    static wius_udp_msg_t parity_msgs[TP_FEC_MAX_M];
+    size_t num_parity = 0;
 
-    tp_buffer_return(&tp_buf, slot_udp, true);
+    _tp_transmit_parity(&header, parity_msgs, &num_parity);
+    status = _tp_transmit_batch(parity_msgs, num_parity);
   }
+  tp_fec_reset(&tp_fec);
+
+  // Release packets filled but not sent after an error
+  tp_buffer_slot_t *slot_left;
+  while (NULL != (slot_left = tp_buffer_claim_reading(&tp_buf)))
+  {
+    tp_buffer_return(&tp_buf, slot_left, true);
+  }
+
+  if (SL_STATUS_OK != wius_udp_flush(TP_UDP_TX_TIMEOUT_MS))
+  {
+    LOG_W("Timeout flushing packets");
+  }
+
+  tp_pacing_shot_end();
+  tp_retx_pause(false);
 
   LOG_D("Shot acquired");
 
@@ -649,7 +1435,7 @@ sl_status_t _tp_transmit_packages(void)
 //
 //  for (uint16_t i = 0; i < n_packs_to_read; i++)
 //  {
-//    status = wius_udp_sendto(&tp_socket, tx_buf, TP_UDP_PACKET_SIZE + 2, client_ip, client_port);
+//    status = wius_udp_sendto_peer(&tp_socket, tx_buf, TP_UDP_PACKET_SIZE + 2, &client_peer);
 //    if (SL_STATUS_OK != status)
 //      LOG_W("Error transmitting packet");
 //    delay_ns(149000);
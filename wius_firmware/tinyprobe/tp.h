@@ -15,6 +15,18 @@
 
 #include "common.h"
 
+/**
+ * @brief Register targets of the WRITE_PARAM command
+ *
+ */
+typedef enum tp_param_target
+{
+  TP_PARAM_TARGET_FPGA = 0, /**< FPGA register */
+  TP_PARAM_TARGET_AFE,      /**< AFE register */
+  TP_PARAM_TARGET_AFE_DTGC, /**< AFE DTGC register */
+  TP_PARAM_TARGET_TX        /**< TX register */
+} tp_param_target_t;
+
 /**
  * @brief Initialize the FPGA (SPI, GPIOs, register values)
  *
@@ -36,5 +48,16 @@ sl_status_t tp_delay_ns(uint8_t *args, uint16_t args_length);
 sl_status_t tp_sleep_ms(uint8_t *args, uint16_t args_length);
 sl_status_t tp_ctrl_pwr(uint8_t *args, uint16_t args_length);
 sl_status_t tp_trigger_shot(uint8_t *args, uint16_t args_length);
+sl_status_t tp_wait_fpga_irq(uint8_t *args, uint16_t args_length);
+sl_status_t tp_set_param(uint8_t *args, uint16_t args_length);
+sl_status_t tp_write_param(uint8_t *args, uint16_t args_length);
+sl_status_t tp_get_stats(uint8_t *args, uint16_t args_length);
+sl_status_t tp_set_fec(uint8_t *args, uint16_t args_length);
+sl_status_t tp_pacing(uint8_t *args, uint16_t args_length);
+sl_status_t tp_credit(uint8_t *args, uint16_t args_length);
+sl_status_t tp_subscribe(uint8_t *args, uint16_t args_length);
+sl_status_t tp_twt(uint8_t *args, uint16_t args_length);
+sl_status_t tp_link(uint8_t *args, uint16_t args_length);
+sl_status_t tp_standby(uint8_t *args, uint16_t args_length);
 
 #endif /* TP_H_ */
@@ -0,0 +1,71 @@
+/**
+ * @file twt.c
+ *
+ * @brief Target wake time scheduling implementation for the TinyProbe
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#include "twt.h"
+
+#include "cmsis_os2.h"
+
+#include "tinyprobe/perf.h"
+#include "wius/wifi.h"
+
+uint32_t _tp_twt_airtime_us(uint16_t packets)
+{
+  return packets * TP_TWT_PACKET_AIRTIME_US + TP_TWT_GUARD_US;
+}
+
+sl_status_t tp_twt_config(bool enable, uint32_t period_us, uint16_t packets)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  if (!enable)
+  {
+    CHECK_STATUS(wius_wifi_twt_disable());
+    return tp_perf_set_active(WIUS_PERF_PROFILE_HIGHSPEED);
+  }
+
+  uint32_t duration_us = _tp_twt_airtime_us(packets);
+  if (duration_us >= period_us)
+  {
+    LOG_W("Shot of %u packets does not fit into %lu us", packets, period_us);
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  CHECK_STATUS(wius_wifi_twt_enable(period_us, duration_us));
+
+  // The radio only sleeps between service periods with power save
+  return tp_perf_set_active(WIUS_PERF_PROFILE_LOWPOWER);
+}
+
+uint32_t tp_twt_align(uint16_t packets)
+{
+  // The network processor holds frames back outside the service periods on its own
+  if (!TP_TWT_ALIGN)
+    return 0;
+
+  wius_wifi_twt_t twt;
+  wius_wifi_twt_get(&twt);
+
+  if (!twt.active || 0 == twt.interval_us)
+    return 0;
+
+  // The service period schedule is not visible to the M4, assume it repeats from the agreement
+  uint64_t elapsed_us = (uint64_t)(osKernelGetTickCount() - twt.setup_tick) * 1000000 / TICKS_PER_SEC;
+  uint32_t phase_us = (uint32_t)(elapsed_us % twt.interval_us);
+
+  if (phase_us + _tp_twt_airtime_us(packets) <= twt.duration_us)
+    return 0;
+
+  uint32_t wait_us = twt.interval_us - phase_us;
+  osDelay((wait_us * (uint64_t)TICKS_PER_SEC + 999999) / 1000000);
+
+  return wait_us;
+}
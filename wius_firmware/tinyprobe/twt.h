@@ -0,0 +1,50 @@
+/**
+ * @file twt.h
+ *
+ * @brief Target wake time scheduling for the TinyProbe
+ *
+ * The wake interval is the shot period and the service period covers the airtime of one shot.
+ * The agreement restricts transmissions to the service periods, so the network processor holds
+ * frames back that do not fit into the current one anymore. With @ref TP_TWT_ALIGN, shots are
+ * also held back on the M4. The M4 does not see the service period schedule and assumes it
+ * repeats from the agreement. A wrong guess adds up to one interval of latency per shot.
+ *
+ * @author Cédric Hirschi, ETH Zürich
+ * @date 18.10.2026
+ *
+ * @ingroup tinyprobe
+ *
+ */
+
+#ifndef TP_TWT_H_
+#define TP_TWT_H_
+
+#include "common.h"
+
+/**
+ * @brief Negotiate or tear down target wake time for periodic shots
+ *
+ * @param enable: Whether to negotiate (true) or tear down (false) the agreement
+ * @param period_us: Shot period in us
+ * @param packets: Packets per shot
+ *
+ * @retval SL_STATUS_OK: Request sent
+ * @retval SL_STATUS_INVALID_PARAMETER: A shot does not fit into one period
+ * @retval other: Sending the request failed
+ *
+ */
+sl_status_t tp_twt_config(bool enable, uint32_t period_us, uint16_t packets);
+
+/**
+ * @brief Wait until a shot of @p packets fits into a service period
+ *
+ * @param packets: Packets of the shot about to be sent
+ *
+ * @return Time waited in us
+ *
+ * @note Returns immediately without an agreement or without @ref TP_TWT_ALIGN
+ *
+ */
+uint32_t tp_twt_align(uint16_t packets);
+
+#endif /* TP_TWT_H_ */
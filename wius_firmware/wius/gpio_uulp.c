@@ -56,6 +56,8 @@ sl_status_t wius_gpio_uulp_pin_attach_interrupt(wius_gpio_uulp_t gpio, wius_gpio
   uulp_interrupt_functions[gpio.pin] = function;
 
   sl_si91x_gpio_configure_uulp_interrupt((sl_si91x_gpio_interrupt_config_flag_t)trigger, gpio.pin);
+  // Let the pin wake the M4 from tickless idle sleep
+  sl_si91x_gpio_set_uulp_npss_wakeup_interrupt(gpio.pin);
 
   NVIC_EnableIRQ(UULP_PININT_NVIC_NAME);
   NVIC_SetPriority(UULP_PININT_NVIC_NAME, 7);
@@ -14,40 +14,188 @@
 
 #include <sl_si91x_power_manager.h>
 
-#define WIUS_POWER_FREQ_HIGH 180000000 /**< System clock in high performance mode (180MHz) */
-#define WIUS_POWER_FREQ_LOW   32000000 /**< System clock in low power mode (32MHz) */
+#include "si91x_device.h"
 
-sl_status_t wius_power_init(void)
+#include "wius/spi.h"
+
+static wius_power_mode_t _power_mode = WIUS_POWER_MODE_HIGH;
+static wius_power_stats_t _power_stats = {0};
+static volatile uint32_t _power_sleep_blocks = 0;
+static volatile bool _power_woken = false;
+static volatile uint32_t _power_wake_cycles = 0;
+
+// FreeRTOS port, programs SysTick and caches the reload for tickless idle
+extern void vPortSetupTimerInterrupt(void);
+
+/**
+ * @brief Reload SysTick for the current core clock
+ *
+ * The port derives the reload and the tickless idle limits from configCPU_CLOCK_HZ
+ * (SystemCoreClock) and writes its cached reload back after every suppressed tick period, so
+ * only setting SysTick->LOAD would be undone by the next sleep.
+ *
+ * @note Not verified on target yet: check that osDelay() keeps its length in both modes and
+ *       across tickless sleeps after a clock switch
+ *
+ */
+static void _power_update_tick(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  vPortSetupTimerInterrupt();
+
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Switch the power state and clock of the M4
+ *
+ * @param mode: Mode to switch to
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Any power manager function returned an error
+ *
+ */
+static sl_status_t _power_set_mode(wius_power_mode_t mode)
 {
   sl_status_t status = SL_STATUS_OK;
 
+  if (mode == _power_mode)
+    return status;
+
+  sl_power_state_t state = (WIUS_POWER_MODE_HIGH == mode) ? SL_SI91X_POWER_MANAGER_PS4 : SL_SI91X_POWER_MANAGER_PS3;
+  sl_power_state_t previous = (WIUS_POWER_MODE_HIGH == mode) ? SL_SI91X_POWER_MANAGER_PS3 : SL_SI91X_POWER_MANAGER_PS4;
+  sl_clock_scaling_t scaling = (WIUS_POWER_MODE_HIGH == mode) ? SL_SI91X_POWER_MANAGER_PERFORMANCE : SL_SI91X_POWER_MANAGER_POWERSAVE;
+
+  uint32_t clock = SystemCoreClock;
+  uint32_t start = DWT->CYCCNT;
+
+  // Requirements are counted, hold the new state before releasing the previous one
+  CHECK_STATUS(sl_si91x_power_manager_add_ps_requirement(state));
+  if (_power_stats.transitions > 0)
+  {
+    CHECK_STATUS(sl_si91x_power_manager_remove_ps_requirement(previous));
+  }
+  CHECK_STATUS(sl_si91x_power_manager_set_clock_scaling(scaling));
+
+  SystemCoreClockUpdate();
+  _power_update_tick();
+
+  // The SPI dividers are derived from the clock at configuration time
+  CHECK_STATUS(wius_spi_update_clock());
+
+  // The cycle counter ran on both clocks, the slower one gives an upper bound
+  uint32_t cycles = DWT->CYCCNT - start;
+  if (SystemCoreClock < clock)
+    clock = SystemCoreClock;
+  uint32_t latency_us = cycles / (clock / 1000000);
+
+  _power_mode = mode;
+  _power_stats.transitions++;
+  _power_stats.last_us = latency_us;
+  if (latency_us > _power_stats.max_us)
+    _power_stats.max_us = latency_us;
+
+  LOG_D("M4 at %lu Hz after %lu us", SystemCoreClock, latency_us);
+
   return status;
 }
 
-sl_status_t wius_power_m4_low(void)
+sl_status_t wius_power_init(void)
 {
   sl_status_t status = SL_STATUS_OK;
 
-//  CHECK_STATUS(sl_si91x_power_manager_add_ps_requirement(SL_SI91X_POWER_MANAGER_PS3));
-//  CHECK_STATUS(sl_si91x_power_manager_set_clock_scaling(SL_SI91X_POWER_MANAGER_POWERSAVE));
-//  if(0 != SysTick_Config(WIUS_POWER_FREQ_LOW / 1000))
-//  {
-//    return SL_STATUS_FAIL;
-//  }
+  // The DWT cycle counter measures the transition and wakeup latency
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  CHECK_STATUS(sl_si91x_power_manager_set_wakeup_sources(SL_SI91X_POWER_MANAGER_GPIO_WAKEUP
+                                                         | SL_SI91X_POWER_MANAGER_WIRELESS_WAKEUP
+                                                         | SL_SI91X_POWER_MANAGER_ULPSS_WAKEUP, true));
 
   return status;
 }
 
+sl_status_t wius_power_m4_low(void)
+{
+  return _power_set_mode(WIUS_POWER_MODE_LOW);
+}
+
 sl_status_t wius_power_m4_high(void)
 {
-  sl_status_t status = SL_STATUS_OK;
+  return _power_set_mode(WIUS_POWER_MODE_HIGH);
+}
 
-//  CHECK_STATUS(sl_si91x_power_manager_add_ps_requirement(SL_SI91X_POWER_MANAGER_PS4));
-//  CHECK_STATUS(sl_si91x_power_manager_set_clock_scaling(SL_SI91X_POWER_MANAGER_PERFORMANCE));
-//  if(0 != SysTick_Config(WIUS_POWER_FREQ_LOW / 1000))
-//  {
-//    return SL_STATUS_FAIL;
-//  }
+wius_power_mode_t wius_power_get_mode(void)
+{
+  return _power_mode;
+}
 
-  return status;
+void wius_power_get_stats(wius_power_stats_t *stats)
+{
+  *stats = _power_stats;
+}
+
+void wius_power_sleep_block(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  _power_sleep_blocks++;
+  __set_PRIMASK(primask);
+}
+
+void wius_power_sleep_unblock(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (_power_sleep_blocks > 0)
+    _power_sleep_blocks--;
+  __set_PRIMASK(primask);
+}
+
+bool wius_power_take_wakeup(uint32_t *cycles)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  bool woken = _power_woken;
+  *cycles = _power_wake_cycles;
+  _power_woken = false;
+  __set_PRIMASK(primask);
+
+  return woken;
+}
+
+/**
+ * @brief Power manager hook deciding whether tickless idle may sleep
+ *
+ * @note Called with interrupts disabled
+ *
+ */
+boolean_t app_is_ok_to_sleep(void)
+{
+  // A sleeping M4 would stall SPI DMA transfers
+  if (_power_sleep_blocks > 0 || wius_spi_is_busy())
+    return false;
+
+  _power_stats.sleeps++;
+
+  // Only a wakeup from this sleep counts, not one handled before it
+  _power_woken = false;
+
+  return true;
+}
+
+/**
+ * @brief Power manager hook called after an interrupt woke the M4 from sleep
+ *
+ */
+sl_si91x_power_manager_on_isr_exit_t app_sleep_on_isr_exit(void)
+{
+  _power_stats.wakeups++;
+  _power_wake_cycles = DWT->CYCCNT;
+  _power_woken = true;
+
+  // Every wakeup source is an event to be handled by a thread
+  return SL_SI91X_POWER_MANAGER_ISR_WAKEUP;
 }
@@ -15,12 +15,39 @@
 
 #include "common.h"
 
+/**
+ * @brief M4 power modes
+ *
+ */
+typedef enum wius_power_mode
+{
+  WIUS_POWER_MODE_LOW,  /**< PS3 with power save clock scaling */
+  WIUS_POWER_MODE_HIGH, /**< PS4 with performance clock scaling */
+} wius_power_mode_t;
+
+/**
+ * @brief Power mode transition statistics
+ *
+ */
+typedef struct wius_power_stats
+{
+  uint32_t transitions; /**< Number of mode transitions */
+  uint32_t last_us;     /**< Latency of the last transition in us */
+  uint32_t max_us;      /**< Maximum transition latency in us */
+  uint32_t sleeps;      /**< Number of times tickless idle was allowed to sleep */
+  uint32_t wakeups;     /**< Number of interrupts that woke the M4 from sleep */
+} wius_power_stats_t;
+
 /**
  * @brief Initialize the power management module
  *
- * @return SL_STATUS_OK
+ * Configures the sources that wake the M4 from tickless idle sleep: UULP GPIO interrupts, the
+ * network processor (socket events) and the ULP timer of the kernel.
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Configuring the wakeup sources failed
  *
- * @note This function currently does nothing
+ * @note The power manager itself is initialized by the platform services
  *
  */
 sl_status_t wius_power_init(void);
@@ -28,8 +55,11 @@ sl_status_t wius_power_init(void);
 /**
  * @brief Set the M4 SOC to low power mode
  *
+ * SysTick is reloaded to keep the kernel tick rate and the SPI dividers are derived again from
+ * the new clock. Does nothing if the mode is already active.
+ *
  * @retval SL_STATUS_OK: Success
- * @retval SL_STATUS_FAIL: Any RSI function returned an error
+ * @retval other: Any power manager or SPI function returned an error
  *
  */
 sl_status_t wius_power_m4_low(void);
@@ -38,9 +68,54 @@ sl_status_t wius_power_m4_low(void);
  * @brief Set the M4 SOC to high power mode
  *
  * @retval SL_STATUS_OK: Success
- * @retval SL_STATUS_FAIL: Any RSI function returned an error
+ * @retval other: Any power manager or SPI function returned an error
+ *
+ * @see wius_power_m4_low
  *
  */
 sl_status_t wius_power_m4_high(void);
 
+/**
+ * @brief Get the active M4 power mode
+ *
+ * @return Active mode
+ *
+ */
+wius_power_mode_t wius_power_get_mode(void);
+
+/**
+ * @brief Keep the M4 awake until @ref wius_power_sleep_unblock
+ *
+ * Calls nest, sleep is only allowed again once every block was released.
+ *
+ */
+void wius_power_sleep_block(void);
+
+/**
+ * @brief Release a block taken with @ref wius_power_sleep_block
+ *
+ */
+void wius_power_sleep_unblock(void);
+
+/**
+ * @brief Get the cycle count of the last wakeup from sleep
+ *
+ * @param cycles: Pointer to store the cycle count at the wakeup
+ *
+ * @return Whether the M4 woke up from its last sleep since the last call
+ *
+ * @note The flag is cleared whenever the M4 enters sleep, so it never reports a wakeup older
+ *       than the last sleep
+ *
+ */
+bool wius_power_take_wakeup(uint32_t *cycles);
+
+/**
+ * @brief Get the transition statistics
+ *
+ * @param stats: Pointer to store the statistics
+ *
+ */
+void wius_power_get_stats(wius_power_stats_t *stats);
+
 #endif /* WIUS_POWER_H_ */
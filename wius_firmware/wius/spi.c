@@ -56,6 +56,7 @@ static sl_ssi_handle_t ssi_driver_handle = NULL;
 osSemaphoreId_t spi0_sem;
 osSemaphoreId_t spi1_sem;
 static volatile bool spi0_transfer_complete = false;
+static volatile bool spi_busy[WIUS_SPI_MAX_INST] = {false};
 
 static void gspi_callback_event(uint32_t event);
 static void ssi_callback_event(uint32_t event);
@@ -174,6 +175,38 @@ sl_status_t wius_spi_init(wius_spi_inst_t instance)
   return status;
 }
 
+sl_status_t wius_spi_update_clock(void)
+{
+  sl_status_t status = SL_STATUS_OK;
+
+  if (NULL != gspi_driver_handle)
+  {
+    status = sl_si91x_gspi_set_configuration(gspi_driver_handle, NULL);
+    if (status != SL_STATUS_OK)
+    {
+      LOG_E("Error setting SPI configuration: 0x%lx", status);
+      return status;
+    }
+  }
+
+  if (NULL != ssi_driver_handle)
+  {
+    status = sl_si91x_ssi_set_configuration(ssi_driver_handle, NULL, SSI_SLAVE_0);
+    if (status != SL_STATUS_OK)
+    {
+      LOG_E("Error setting SPI configuration: 0x%lx", status);
+      return status;
+    }
+  }
+
+  return status;
+}
+
+bool wius_spi_is_busy(void)
+{
+  return spi_busy[WIUS_SPI_INST_0] || spi_busy[WIUS_SPI_INST_1];
+}
+
 sl_gspi_handle_t wius_spi0_get_handle(void)
 {
   return gspi_driver_handle;
@@ -442,9 +475,11 @@ sl_status_t wius_spi_xfer(wius_spi_inst_t instance, uint8_t *tx_buf, uint8_t *rx
     WIUS_SPI_CS0_LOW;
 
     spi0_transfer_complete = false;
+    spi_busy[WIUS_SPI_INST_0] = true;
     status = sl_si91x_gspi_transfer_data(gspi_driver_handle, tx_buf, rx_buf, len);
     if (SL_STATUS_OK != status)
     {
+      spi_busy[WIUS_SPI_INST_0] = false;
       WIUS_SPI_CS0_HIGH;
       return status;
     }
@@ -458,9 +493,11 @@ sl_status_t wius_spi_xfer(wius_spi_inst_t instance, uint8_t *tx_buf, uint8_t *rx
 
     WIUS_SPI_CS1_LOW;
 
+    spi_busy[WIUS_SPI_INST_1] = true;
     status = sl_si91x_ssi_transfer_data(ssi_driver_handle, tx_buf, rx_buf, len);
     if (SL_STATUS_OK != status)
     {
+      spi_busy[WIUS_SPI_INST_1] = false;
       WIUS_SPI_CS1_HIGH;
       return status;
     }
@@ -486,7 +523,10 @@ sl_status_t wius_spi0_xfer_cont(uint8_t *tx_buf, uint8_t *rx_buf, size_t len)
   WIUS_SPI_CS0_LOW;
 
   spi0_transfer_complete = false;
+  spi_busy[WIUS_SPI_INST_0] = true;
   sl_status_t status = sl_si91x_gspi_transfer_data_cont(gspi_driver_handle, tx_buf, rx_buf, len);
+  if (SL_STATUS_OK != status)
+    spi_busy[WIUS_SPI_INST_0] = false;
 
   WIUS_SPI_CS0_HIGH;
 
@@ -499,12 +539,15 @@ static void gspi_callback_event(uint32_t event)
   {
   case SL_GSPI_TRANSFER_COMPLETE:
 //     osEventFlagsSet(event_flags, FLAG_SPI_TF0_DONE);
+     spi_busy[WIUS_SPI_INST_0] = false;
      osSemaphoreRelease(spi0_sem);
     break;
   case SL_GSPI_DATA_LOST:
+    spi_busy[WIUS_SPI_INST_0] = false;
     LOG_D("SPI0: Data lost");
     break;
   case SL_GSPI_MODE_FAULT:
+    spi_busy[WIUS_SPI_INST_0] = false;
     LOG_D("SPI0: Mode fault");
     break;
   }
@@ -516,12 +559,15 @@ static void ssi_callback_event(uint32_t event)
   {
   case SSI_EVENT_TRANSFER_COMPLETE:
     // osEventFlagsSet(event_flags, FLAG_SPI_TF1_DONE);
+    spi_busy[WIUS_SPI_INST_1] = false;
     osSemaphoreRelease(spi1_sem);
     break;
   case SSI_EVENT_DATA_LOST:
+    spi_busy[WIUS_SPI_INST_1] = false;
     LOG_D("SPI1: Data lost");
     break;
   case SSI_EVENT_MODE_FAULT:
+    spi_busy[WIUS_SPI_INST_1] = false;
     LOG_D("SPI1: Mode fault");
     break;
   }
@@ -38,6 +38,27 @@ typedef enum wius_spi_inst
  */
 sl_status_t wius_spi_init(wius_spi_inst_t instance);
 
+/**
+ * @brief Apply the configuration of all initialized instances again
+ *
+ * The bit rate dividers are derived from the source clock, call this after the clock changed.
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Error during peripheral configuration
+ *
+ * @note Must not be called during a transfer
+ *
+ */
+sl_status_t wius_spi_update_clock(void);
+
+/**
+ * @brief Check whether a transfer is in progress on any instance
+ *
+ * @return Whether a transfer was started and did not complete yet
+ *
+ */
+bool wius_spi_is_busy(void);
+
 /**
  * @brief Transfer data over SPI
  *
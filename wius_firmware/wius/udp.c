@@ -12,13 +12,48 @@
 
 #include "udp.h"
 
+#include "cmsis_os2.h"
+#include "si91x_device.h"
 #include "errno.h"
 #include "sl_net.h"
 #include "sl_si91x_driver.h"
+#include "sl_si91x_socket.h"
 #include <netinet_in.h>
+#include <string.h>
 
 #define MAX_PACKET_SIZE 1472
 
+/**
+ * @brief In-flight asynchronous send
+ *
+ */
+typedef struct
+{
+	wius_udp_tx_done_t done; // Completion callback
+	void *context;			 // Completion context
+	int32_t socket;			 // Socket the datagram was submitted on
+	uint32_t submitted;		 // Kernel tick of the submission
+	volatile bool completed; // Completion arrived, waiting for the entries before it
+} _udp_tx_entry_t;
+
+// Asynchronous sends in flight, freed in submission order
+static _udp_tx_entry_t _udp_tx_queue[WIUS_UDP_TX_QUEUE_DEPTH];
+static volatile uint32_t _udp_tx_head = 0; // Oldest entry not freed yet
+static volatile uint32_t _udp_tx_tail = 0; // Next entry to submit
+static osSemaphoreId_t _udp_tx_free = NULL;
+static osMutexId_t _udp_tx_lock = NULL; // Serializes claiming and submitting entries
+static osSemaphoreId_t _udp_tx_idle = NULL; // Released whenever the queue drained
+static wius_udp_tx_stats_t _udp_tx_stats = {0};
+
+// Sockets of reclaimed entries, a late completion of such an entry must not complete the next one
+static int32_t _udp_tx_stale[WIUS_UDP_TX_QUEUE_DEPTH];
+static uint32_t _udp_tx_stale_count = 0;
+
+static void _udp_tx_complete(int32_t socket, uint16_t length);
+static bool _udp_tx_complete_entry(int32_t socket);
+static void _udp_tx_free_completed(void);
+static void _udp_tx_reclaim(void);
+
 ssize_t _udp_sendto_fragmented(int fd, const void *data, size_t data_len,
 							   int flags, const struct sockaddr *to_addr, socklen_t to_addr_len);
 
@@ -30,6 +65,21 @@ void wius_udp_init(wius_udp_t *udp)
 	udp->server_address.sin_family = -1;
 	udp->server_address.sin_port = -1;
 	udp->server_address.sin_addr.s_addr = -1;
+
+	if (NULL == _udp_tx_free)
+	{
+		_udp_tx_free = osSemaphoreNew(WIUS_UDP_TX_QUEUE_DEPTH, WIUS_UDP_TX_QUEUE_DEPTH, NULL);
+	}
+
+	if (NULL == _udp_tx_lock)
+	{
+		_udp_tx_lock = osMutexNew(NULL);
+	}
+
+	if (NULL == _udp_tx_idle)
+	{
+		_udp_tx_idle = osSemaphoreNew(1, 0, NULL);
+	}
 }
 
 sl_status_t wius_udp_bind(wius_udp_t *udp, char *ip, int port)
@@ -78,6 +128,66 @@ sl_status_t wius_udp_close(wius_udp_t *udp)
 	return SL_STATUS_OK;
 }
 
+sl_status_t wius_udp_reopen(wius_udp_t *udp)
+{
+	// The address survives a failed reopen, only a socket that was never bound or was closed has none
+	if (AF_INET != udp->server_address.sin_family || NULL == _udp_tx_lock)
+	{
+		return SL_STATUS_SI91X_SOCKET_NOT_CONNECTED;
+	}
+
+	// Senders claim entries with the lock held, none submits while the socket is replaced
+	osMutexAcquire(_udp_tx_lock, osWaitForever);
+
+	// A receiver blocked on the old socket returns with an error and retries on the new one, a
+	// failed earlier reopen left no socket to close
+	int old_socket = udp->socket;
+	if (udp->connected)
+	{
+		close(old_socket);
+	}
+	udp->connected = false;
+
+	// Sends in flight on the old socket never complete, hand their buffers back
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	while (_udp_tx_complete_entry(old_socket))
+	{
+	}
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < _udp_tx_stale_count; i++)
+	{
+		if (old_socket != _udp_tx_stale[i])
+			_udp_tx_stale[kept++] = _udp_tx_stale[i];
+	}
+	_udp_tx_stale_count = kept;
+	__set_PRIMASK(primask);
+
+	udp->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (0 > udp->socket)
+	{
+		udp->socket = -1;
+		osMutexRelease(_udp_tx_lock);
+		return SL_STATUS_SI91X_SOCKET_NOT_CREATED;
+	}
+
+	int status = bind(udp->socket, (struct sockaddr *)&udp->server_address,
+					  sizeof(udp->server_address));
+	if (0 > status)
+	{
+		close(udp->socket);
+		udp->socket = -1;
+		osMutexRelease(_udp_tx_lock);
+		return SL_STATUS_SI91X_SOCKET_NOT_CONNECTED;
+	}
+
+	udp->connected = true;
+
+	osMutexRelease(_udp_tx_lock);
+
+	return SL_STATUS_OK;
+}
+
 sl_status_t wius_udp_send(wius_udp_t *udp, const uint8_t *data, size_t data_len)
 {
 	if (!udp->connected)
@@ -98,20 +208,33 @@ sl_status_t wius_udp_send(wius_udp_t *udp, const uint8_t *data, size_t data_len)
 
 sl_status_t wius_udp_sendto(wius_udp_t *udp, const uint8_t *data, size_t data_len,
 							char *ip, int port)
+{
+	wius_udp_peer_t peer;
+	wius_udp_peer_set(&peer, ip, port);
+
+	return wius_udp_sendto_peer(udp, data, data_len, &peer);
+}
+
+sl_status_t wius_udp_peer_set(wius_udp_peer_t *peer, char *ip, int port)
+{
+	memset(&peer->address, 0, sizeof(peer->address));
+	peer->address.sin_family = AF_INET;
+	peer->address.sin_port = port;
+
+	return sl_net_inet_addr(ip, &peer->address.sin_addr.s_addr);
+}
+
+sl_status_t wius_udp_sendto_peer(wius_udp_t *udp, const uint8_t *data, size_t data_len,
+								 const wius_udp_peer_t *peer)
 {
 	if (!udp->connected)
 	{
 		return SL_STATUS_SI91X_SOCKET_NOT_CONNECTED;
 	}
 
-	struct sockaddr_in client_address;
-	client_address.sin_family = AF_INET;
-	client_address.sin_port = port;
-	sl_net_inet_addr(ip, &client_address.sin_addr.s_addr);
-
 	int bytes_sent = _udp_sendto_fragmented(udp->socket, data, data_len, 0,
-											(struct sockaddr *)&client_address,
-											sizeof(client_address));
+											(const struct sockaddr *)&peer->address,
+											sizeof(peer->address));
 	if (0 > bytes_sent)
 	{
 		return SL_STATUS_SI91X_IO_FAIL;
@@ -158,6 +281,30 @@ sl_status_t wius_udp_receive(wius_udp_t *udp, uint8_t *buffer, size_t buffer_len
 
 sl_status_t wius_udp_receivefrom(wius_udp_t *udp, uint8_t *buffer, size_t buffer_len, ssize_t *received_len,
 								 char *ip, size_t ip_len, int *port, int32_t timeout_ms)
+{
+	sl_status_t status = SL_STATUS_OK;
+	wius_udp_peer_t peer;
+
+	CHECK_STATUS(wius_udp_receivefrom_peer(udp, buffer, buffer_len, received_len, &peer, timeout_ms));
+
+	// if client socket is passed, replace port and ip
+	if ((NULL != ip) && ip_len)
+	{
+		const uint8_t *bytes = (const uint8_t *)&peer.address.sin_addr.s_addr;
+
+		snprintf(ip, ip_len, "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+	}
+
+	if ((NULL != port))
+	{
+		*port = peer.address.sin_port;
+	}
+
+	return SL_STATUS_OK;
+}
+
+sl_status_t wius_udp_receivefrom_peer(wius_udp_t *udp, uint8_t *buffer, size_t buffer_len, ssize_t *received_len,
+									  wius_udp_peer_t *peer, int32_t timeout_ms)
 {
 	if (!udp->connected)
 	{
@@ -178,9 +325,9 @@ sl_status_t wius_udp_receivefrom(wius_udp_t *udp, uint8_t *buffer, size_t buffer
 				   sizeof(tv));
 	}
 
-	struct sockaddr from_addr;
+	struct sockaddr_in from_addr;
 	socklen_t from_addr_len = sizeof(from_addr);
-	ssize_t len = recvfrom(udp->socket, buffer, buffer_len, 0, &from_addr,
+	ssize_t len = recvfrom(udp->socket, buffer, buffer_len, 0, (struct sockaddr *)&from_addr,
 						   &from_addr_len);
 	if (len < 0)
 	{
@@ -190,29 +337,267 @@ sl_status_t wius_udp_receivefrom(wius_udp_t *udp, uint8_t *buffer, size_t buffer
 
 	*received_len = len; // Set the actual received length
 
-	// if client socket is passed, replace port and ip
-	if ((NULL != ip) && ip_len)
+	if (NULL != peer)
 	{
-		struct sockaddr_in *addr_in = (struct sockaddr_in *)&from_addr;
+		peer->address = from_addr;
+	}
 
-		uint8_t byte1 = (addr_in->sin_addr.s_addr & (0xFF << 24)) >> 24;
-		uint8_t byte2 = (addr_in->sin_addr.s_addr & (0xFF << 16)) >> 16;
-		uint8_t byte3 = (addr_in->sin_addr.s_addr & (0xFF << 8)) >> 8;
-		uint8_t byte4 = (addr_in->sin_addr.s_addr & (0xFF << 0)) >> 0;
+	return SL_STATUS_OK;
+}
 
-		snprintf(ip, ip_len, "%u.%u.%u.%u", byte4, byte3, byte2, byte1);
+sl_status_t wius_udp_sendto_peer_async(wius_udp_t *udp, const uint8_t *data, size_t data_len,
+									   const wius_udp_peer_t *peer, wius_udp_tx_done_t done,
+									   void *context, uint32_t timeout_ms)
+{
+	wius_udp_msg_t msg = {
+		.data = data,
+		.data_len = data_len,
+		.done = done,
+		.context = context,
+	};
+	size_t num_sent = 0;
+
+	return wius_udp_sendmmsg_peer(udp, &msg, 1, peer, &num_sent, timeout_ms);
+}
+
+sl_status_t wius_udp_sendmmsg_peer(wius_udp_t *udp, const wius_udp_msg_t *msgs, size_t num_msgs,
+								   const wius_udp_peer_t *peer, size_t *num_sent, uint32_t timeout_ms)
+{
+	*num_sent = 0;
+
+	if (!udp->connected || NULL == _udp_tx_free || NULL == _udp_tx_lock)
+	{
+		return SL_STATUS_SI91X_SOCKET_NOT_CONNECTED;
 	}
 
-	if ((NULL != port))
+	uint32_t timeout_ticks = timeout_ms ? (timeout_ms * TICKS_PER_SEC + 999) / 1000 : 0;
+
+	for (size_t i = 0; i < num_msgs; i++)
 	{
-		struct sockaddr_in *addr_in = (struct sockaddr_in *)&from_addr;
+		if (msgs[i].data_len > MAX_PACKET_SIZE)
+		{
+			return SL_STATUS_INVALID_PARAMETER;
+		}
+
+		_udp_tx_reclaim();
 
-		*port = addr_in->sin_port;
+		if (osOK != osSemaphoreAcquire(_udp_tx_free, timeout_ticks))
+		{
+			_udp_tx_stats.full++;
+			return SL_STATUS_WOULD_BLOCK;
+		}
+
+		// Other threads submit too, the entry must be the last one until its send was handed over
+		osMutexAcquire(_udp_tx_lock, osWaitForever);
+
+		// Publish the entry before sending, the completion may arrive before sendto returns
+		uint32_t claimed = _udp_tx_tail;
+		_udp_tx_entry_t *entry = &_udp_tx_queue[claimed % WIUS_UDP_TX_QUEUE_DEPTH];
+		entry->done = msgs[i].done;
+		entry->context = msgs[i].context;
+		entry->socket = udp->socket;
+		entry->submitted = osKernelGetTickCount();
+		entry->completed = false;
+		_udp_tx_tail = claimed + 1;
+
+		int bytes_sent = sl_si91x_sendto_async(udp->socket, (uint8_t *)msgs[i].data, msgs[i].data_len, 0,
+											   (const struct sockaddr *)&peer->address,
+											   sizeof(peer->address), _udp_tx_complete);
+		if (0 > bytes_sent)
+		{
+			// No completion will arrive for this entry and no other entry was claimed after it
+			_udp_tx_tail = claimed;
+			_udp_tx_stats.failed++;
+			osMutexRelease(_udp_tx_lock);
+			osSemaphoreRelease(_udp_tx_free);
+			return SL_STATUS_SI91X_IO_FAIL;
+		}
+
+		_udp_tx_stats.submitted++;
+		osMutexRelease(_udp_tx_lock);
+		(*num_sent)++;
 	}
 
 	return SL_STATUS_OK;
 }
 
+sl_status_t wius_udp_flush(uint32_t timeout_ms)
+{
+	uint32_t timeout_ticks = (timeout_ms * TICKS_PER_SEC + 999) / 1000;
+	uint32_t reclaim_ticks = (WIUS_UDP_TX_TIMEOUT_MS * TICKS_PER_SEC + 999) / 1000;
+	uint32_t start = osKernelGetTickCount();
+
+	// Drop a release of an earlier drain, the queue is checked after every wakeup anyway
+	osSemaphoreAcquire(_udp_tx_idle, 0);
+
+	while (true)
+	{
+		_udp_tx_reclaim();
+		if (_udp_tx_head == _udp_tx_tail)
+		{
+			return SL_STATUS_OK;
+		}
+
+		uint32_t waited = osKernelGetTickCount() - start;
+		if (waited >= timeout_ticks)
+		{
+			return SL_STATUS_TIMEOUT;
+		}
+
+		// Wake up for reclaiming if the completions stay away
+		uint32_t wait = timeout_ticks - waited;
+		osSemaphoreAcquire(_udp_tx_idle, wait < reclaim_ticks ? wait : reclaim_ticks);
+	}
+}
+
+uint32_t wius_udp_tx_pending(void)
+{
+	return _udp_tx_tail - _udp_tx_head;
+}
+
+void wius_udp_tx_get_stats(wius_udp_tx_stats_t *stats)
+{
+	*stats = _udp_tx_stats;
+}
+
+static void _udp_tx_complete(int32_t socket, uint16_t length)
+{
+	(void)length;
+
+	// Entries of a re-opened socket are completed from another thread
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	// The completion of a reclaimed entry, the entries after it are still in flight
+	for (uint32_t i = 0; i < _udp_tx_stale_count; i++)
+	{
+		if (socket == _udp_tx_stale[i])
+		{
+			memmove(&_udp_tx_stale[i], &_udp_tx_stale[i + 1], (_udp_tx_stale_count - i - 1) * sizeof(_udp_tx_stale[0]));
+			_udp_tx_stale_count--;
+			_udp_tx_stats.late++;
+			__set_PRIMASK(primask);
+			return;
+		}
+	}
+
+	_udp_tx_complete_entry(socket);
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Reclaim the oldest entries whose completion did not arrive in time
+ *
+ * Their callbacks run as if completed, so the buffers go back to their pools and the queue does
+ * not jam if the network processor never reports a datagram.
+ *
+ */
+static void _udp_tx_reclaim(void)
+{
+	uint32_t timeout_ticks = (WIUS_UDP_TX_TIMEOUT_MS * TICKS_PER_SEC + 999) / 1000;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t tail = _udp_tx_tail;
+	for (uint32_t i = _udp_tx_head; i != tail; i++)
+	{
+		_udp_tx_entry_t *entry = &_udp_tx_queue[i % WIUS_UDP_TX_QUEUE_DEPTH];
+		if (osKernelGetTickCount() - entry->submitted < timeout_ticks)
+		{
+			break;
+		}
+		if (entry->completed)
+		{
+			continue;
+		}
+
+		if (NULL != entry->done)
+		{
+			entry->done(entry->context);
+		}
+		entry->completed = true;
+		_udp_tx_stats.reclaimed++;
+
+		// Remember it to swallow its completion, the oldest one is forgotten if all are stale
+		if (WIUS_UDP_TX_QUEUE_DEPTH == _udp_tx_stale_count)
+		{
+			memmove(&_udp_tx_stale[0], &_udp_tx_stale[1], (_udp_tx_stale_count - 1) * sizeof(_udp_tx_stale[0]));
+			_udp_tx_stale_count--;
+		}
+		_udp_tx_stale[_udp_tx_stale_count++] = entry->socket;
+	}
+
+	_udp_tx_free_completed();
+
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Complete the oldest open entry of a socket
+ *
+ * @param socket: Socket the entry was submitted on
+ *
+ * @return Whether an open entry was found
+ *
+ * @note Must be called with interrupts disabled
+ *
+ */
+static bool _udp_tx_complete_entry(int32_t socket)
+{
+	// Sends complete in order per socket, the oldest open entry of this socket is the one
+	uint32_t tail = _udp_tx_tail;
+	_udp_tx_entry_t *entry = NULL;
+	for (uint32_t i = _udp_tx_head; i != tail; i++)
+	{
+		_udp_tx_entry_t *candidate = &_udp_tx_queue[i % WIUS_UDP_TX_QUEUE_DEPTH];
+		if (!candidate->completed && candidate->socket == socket)
+		{
+			entry = candidate;
+			break;
+		}
+	}
+
+	if (NULL == entry)
+	{
+		return false;
+	}
+
+	_udp_tx_stats.completed++;
+
+	if (NULL != entry->done)
+	{
+		entry->done(entry->context);
+	}
+	entry->completed = true;
+
+	_udp_tx_free_completed();
+
+	return true;
+}
+
+/**
+ * @brief Free the completed entries in submission order
+ *
+ * @note Must be called with interrupts disabled
+ *
+ */
+static void _udp_tx_free_completed(void)
+{
+	// An entry is only reused once all before it completed
+	uint32_t tail = _udp_tx_tail;
+	while (_udp_tx_head != tail && _udp_tx_queue[_udp_tx_head % WIUS_UDP_TX_QUEUE_DEPTH].completed)
+	{
+		_udp_tx_head++;
+		osSemaphoreRelease(_udp_tx_free);
+	}
+
+	if (_udp_tx_head == tail && NULL != _udp_tx_idle)
+	{
+		osSemaphoreRelease(_udp_tx_idle);
+	}
+}
+
 ssize_t _udp_sendto_fragmented(int fd, const void *data, size_t data_len,
 							   int flags, const struct sockaddr *to_addr, socklen_t to_addr_len)
 {
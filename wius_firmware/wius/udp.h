@@ -30,6 +30,108 @@ typedef struct wius_udp
     struct sockaddr_in server_address; // Server address structure
 } wius_udp_t;
 
+/**
+ * @brief UDP peer structure
+ *
+ * Holds the binary address of a remote host so it can be sent to without parsing an IP string
+ * for every datagram.
+ *
+ * @note The SiWx91x socket layer keeps @c sin_port in host byte order
+ *
+ */
+typedef struct wius_udp_peer
+{
+    struct sockaddr_in address; // Peer address structure
+} wius_udp_peer_t;
+
+/**
+ * @brief Fragment header of a framed datagram
+ *
+ * Every fragment of a frame starts with this header (little endian), followed by the fragment
+ * payload. All fragments except the last carry the same payload size, so a fragment's offset
+ * in the frame is its index times the payload size of fragment 0. A receiver can reassemble
+ * frames with lost or reordered fragments from the header alone.
+ *
+ * @note Breaking wire change: data packets used to carry the 2 bytes clocked out by the FIFO read
+ *       command in front of the samples. They now start with this 12 byte header instead, so
+ *       the samples moved from offset 2 to offset 12 and each datagram grew by 10 bytes (to
+ *       TP_UDP_PACKET_SIZE + 12). Hosts must be updated together with the firmware.
+ *
+ */
+typedef struct __attribute__((packed)) wius_udp_frag_header
+{
+    uint16_t index;  // Fragment index within the frame
+    uint16_t frame;  // Frame ID
+    uint16_t count;  // Number of fragments in the frame
+    uint16_t flags;  // Fragment flags (0 for data)
+    uint32_t length; // Total frame length in bytes
+} wius_udp_frag_header_t;
+
+#define WIUS_UDP_FRAG_FLAG_RETRANSMIT (1 << 0) /**< Fragment is a retransmission */
+#define WIUS_UDP_FRAG_FLAG_PARITY (1 << 1)     /**< Fragment is a parity packet of the frame */
+
+/**
+ * @brief Completion callback of an asynchronous send
+ *
+ * Called once the network processor has taken over the datagram, so the data buffer may be
+ * reused or returned to its pool.
+ *
+ * @param context: Context passed to @ref wius_udp_sendto_peer_async
+ *
+ * @note Called from the WiSeConnect event context (or @ref wius_udp_reopen) with interrupts
+ *       disabled, keep it short and do not block
+ * @note Without a completion after @ref WIUS_UDP_TX_TIMEOUT_MS the datagram is reclaimed and the
+ *       callback is called by the next send or flush, the buffer may still be read by then if the
+ *       network processor is merely late
+ *
+ */
+typedef void (*wius_udp_tx_done_t)(void *context);
+
+/**
+ * @brief Datagram descriptor for @ref wius_udp_sendmmsg_peer
+ *
+ */
+typedef struct wius_udp_msg
+{
+    const uint8_t *data;     // Data buffer (must stay valid until done is called)
+    size_t data_len;         // Data length (at most one datagram)
+    wius_udp_tx_done_t done; // Completion callback (may be NULL)
+    void *context;           // Context passed to done
+} wius_udp_msg_t;
+
+/**
+ * @brief Asynchronous transmit statistics
+ *
+ */
+typedef struct wius_udp_tx_stats
+{
+    uint32_t submitted; // Number of datagrams handed to the network processor
+    uint32_t completed; // Number of completed datagrams
+    uint32_t failed;    // Number of datagrams rejected by the network processor
+    uint32_t full;      // Number of times the queue was full (backpressure)
+    uint32_t reclaimed; // Number of datagrams reclaimed without a completion
+    uint32_t late;      // Number of completions arriving after their datagram was reclaimed
+} wius_udp_tx_stats_t;
+
+/**
+ * @brief printf format for a @ref wius_udp_peer_t (use with @ref WIUS_UDP_PEER_ARGS)
+ *
+ */
+#define WIUS_UDP_PEER_FMT "%u.%u.%u.%u:%u"
+
+/**
+ * @brief printf arguments for a @ref wius_udp_peer_t (use with @ref WIUS_UDP_PEER_FMT)
+ *
+ * @param peer: Pointer to the peer
+ *
+ */
+#define WIUS_UDP_PEER_ARGS(peer)                                 \
+    ((const uint8_t *)&(peer)->address.sin_addr.s_addr)[0],      \
+        ((const uint8_t *)&(peer)->address.sin_addr.s_addr)[1],  \
+        ((const uint8_t *)&(peer)->address.sin_addr.s_addr)[2],  \
+        ((const uint8_t *)&(peer)->address.sin_addr.s_addr)[3],  \
+        (peer)->address.sin_port
+
 /**
  * @brief Initialize the UDP connection
  *
@@ -66,6 +168,25 @@ sl_status_t wius_udp_bind(wius_udp_t *udp, char *ip, int port);
  */
 sl_status_t wius_udp_close(wius_udp_t *udp);
 
+/**
+ * @brief Replace the UDP socket with a new one bound to the same address
+ *
+ * Sockets do not survive a reconnect of the WiFi client. Asynchronous sends in flight on the old
+ * socket are completed without being sent, and a receive blocked on it returns with an error.
+ * If creating or binding the new socket fails, the connection stays disconnected but keeps its
+ * address, so the reopen can be retried.
+ *
+ * @param udp: UDP connection structure
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_SI91X_SOCKET_NOT_CONNECTED: Socket never binded, closed or binding failed
+ * @retval SL_STATUS_SI91X_SOCKET_NOT_CREATED: Socket creation failed
+ *
+ * @note Thread safe with the asynchronous sends
+ *
+ */
+sl_status_t wius_udp_reopen(wius_udp_t *udp);
+
 /**
  * @brief Send data over a UDP connection
  *
@@ -136,4 +257,137 @@ sl_status_t wius_udp_receive(wius_udp_t *udp, uint8_t *buffer, size_t buffer_len
 sl_status_t wius_udp_receivefrom(wius_udp_t *udp, uint8_t *buffer, size_t buffer_len, ssize_t *received_len,
                                  char *ip, size_t ip_len, int *port, int32_t timeout_ms);
 
+/**
+ * @brief Set a UDP peer from an IP string and port
+ *
+ * @param peer: UDP peer structure
+ * @param ip: Peer IP address
+ * @param port: Peer port
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: IP address could not be parsed
+ *
+ */
+sl_status_t wius_udp_peer_set(wius_udp_peer_t *peer, char *ip, int port);
+
+/**
+ * @brief Send data over a UDP connection to a peer
+ *
+ * @param udp: UDP connection structure
+ * @param data: Data buffer
+ * @param data_len: Data length
+ * @param peer: Destination peer
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_SI91X_SOCKET_NOT_CONNECTED: Socket not binded
+ * @retval SL_STATUS_SI91X_IO_FAIL: Send failed
+ *
+ */
+sl_status_t wius_udp_sendto_peer(wius_udp_t *udp, const uint8_t *data, size_t data_len,
+                                 const wius_udp_peer_t *peer);
+
+/**
+ * @brief Receive data over a UDP connection and retrieve the sender as a peer
+ *
+ * @param udp: UDP connection structure
+ * @param buffer: Buffer to store received data
+ * @param buffer_len: Buffer length
+ * @param received_len: Pointer to store the received data length
+ * @param peer: Pointer to store the sender (may be NULL)
+ * @param timeout_ms: Timeout in milliseconds (set to <= 0 for blocking)
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval SL_STATUS_SI91X_SOCKET_NOT_CONNECTED: Socket not binded
+ * @retval SL_STATUS_INVALID_PARAMETER: buffer or received_len is NULL
+ * @retval SL_STATUS_SI91X_IO_FAIL: Receive failed
+ *
+ */
+sl_status_t wius_udp_receivefrom_peer(wius_udp_t *udp, uint8_t *buffer, size_t buffer_len, ssize_t *received_len,
+                                      wius_udp_peer_t *peer, int32_t timeout_ms);
+
+/**
+ * @brief Send data over a UDP connection to a peer without waiting for the transmission
+ *
+ * The datagram is queued at the network processor and @p done is called once it has been
+ * taken over. At most @ref WIUS_UDP_TX_QUEUE_DEPTH datagrams are in flight, further sends wait
+ * up to @p timeout_ms for a free entry.
+ *
+ * @param udp: UDP connection structure
+ * @param data: Data buffer (must stay valid until @p done is called)
+ * @param data_len: Data length (at most one datagram)
+ * @param peer: Destination peer
+ * @param done: Completion callback (may be NULL)
+ * @param context: Context passed to @p done
+ * @param timeout_ms: Time to wait for a free queue entry in milliseconds (0 to not wait)
+ *
+ * @retval SL_STATUS_OK: Success, @p done will be called
+ * @retval SL_STATUS_SI91X_SOCKET_NOT_CONNECTED: Socket not binded
+ * @retval SL_STATUS_INVALID_PARAMETER: Data does not fit into one datagram
+ * @retval SL_STATUS_WOULD_BLOCK: Queue is full (backpressure)
+ * @retval SL_STATUS_SI91X_IO_FAIL: Send failed
+ *
+ * @note On error @p done is not called and the buffer still belongs to the caller
+ *
+ */
+sl_status_t wius_udp_sendto_peer_async(wius_udp_t *udp, const uint8_t *data, size_t data_len,
+                                       const wius_udp_peer_t *peer, wius_udp_tx_done_t done,
+                                       void *context, uint32_t timeout_ms);
+
+/**
+ * @brief Send multiple datagrams over a UDP connection to a peer without waiting
+ *
+ * Batched version of @ref wius_udp_sendto_peer_async: the datagrams are queued at the network
+ * processor back to back, in order, until one is not accepted.
+ *
+ * @param udp: UDP connection structure
+ * @param msgs: Datagram descriptors
+ * @param num_msgs: Number of datagram descriptors
+ * @param peer: Destination peer
+ * @param num_sent: Pointer to store the number of accepted datagrams
+ * @param timeout_ms: Time to wait for a free queue entry per datagram in milliseconds (0 to not wait)
+ *
+ * @retval SL_STATUS_OK: All datagrams accepted
+ * @retval SL_STATUS_SI91X_SOCKET_NOT_CONNECTED: Socket not binded
+ * @retval SL_STATUS_INVALID_PARAMETER: A datagram does not fit into one datagram
+ * @retval SL_STATUS_WOULD_BLOCK: Queue is full (backpressure)
+ * @retval SL_STATUS_SI91X_IO_FAIL: Send failed
+ *
+ * @note The callbacks of the first @p num_sent datagrams will be called, the remaining buffers
+ *       still belong to the caller
+ * @note Thread safe, datagrams of concurrent callers are interleaved
+ *
+ */
+sl_status_t wius_udp_sendmmsg_peer(wius_udp_t *udp, const wius_udp_msg_t *msgs, size_t num_msgs,
+                                   const wius_udp_peer_t *peer, size_t *num_sent, uint32_t timeout_ms);
+
+/**
+ * @brief Wait until all asynchronous sends are completed
+ *
+ * @param timeout_ms: Timeout in milliseconds
+ *
+ * @retval SL_STATUS_OK: All sends completed or reclaimed
+ * @retval SL_STATUS_TIMEOUT: Sends still in flight
+ *
+ * @note Blocks on the completions instead of polling, sends older than
+ *       @ref WIUS_UDP_TX_TIMEOUT_MS are reclaimed while waiting
+ *
+ */
+sl_status_t wius_udp_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Get the number of asynchronous sends in flight
+ *
+ * @return Number of queued datagrams not yet completed
+ *
+ */
+uint32_t wius_udp_tx_pending(void);
+
+/**
+ * @brief Get the asynchronous transmit statistics
+ *
+ * @param stats: Pointer to store the statistics
+ *
+ */
+void wius_udp_tx_get_stats(wius_udp_tx_stats_t *stats);
+
 #endif // _UDP_H_
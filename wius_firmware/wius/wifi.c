@@ -17,11 +17,18 @@
 #include "sl_net.h"
 #include "sl_net_default_values.h"
 #include "sl_net_wifi_types.h"
+#include "cmsis_os2.h"
 
 #ifndef WIUS_WIFI_FILTER_BROADCAST
 #define WIUS_WIFI_FILTER_BROADCAST 0 /**< Whether to filter the WiFi broadcast */
 #endif
 
+#ifndef WIUS_WIFI_VERIFY_PROFILE
+#define WIUS_WIFI_VERIFY_PROFILE 0 /**< Whether to read back the performance profile after setting it */
+#endif
+
+#define WIUS_WIFI_TWT_FLOW_ID 1 /**< Flow ID of the target wake time agreement */
+
 #if WIUS_WIFI_FILTER_BROADCAST
 #define BROADCAST_DROP_THRESHOLD 5000
 #define BROADCAST_IN_TIM 1
@@ -59,6 +66,17 @@
 //								.config_feature_bit_map =
 //										SL_SI91X_FEAT_SLEEP_GPIO_SEL_BITMAP } };
 
+// Profiles for a full scan with DHCP and for the fast path (cached channel and address)
+static sl_net_wifi_client_profile_t _wifi_full_profile;
+static sl_net_wifi_client_profile_t _wifi_fast_profile;
+static bool _wifi_full_valid = false;
+static bool _wifi_fast_valid = false;
+
+static volatile bool _wifi_connected = false;
+
+// Agreement as last reported by the network processor
+static volatile wius_wifi_twt_t _wifi_twt_agreement = {0};
+
 static const sl_wifi_device_configuration_t station_init_configuration = {
 	.boot_option = LOAD_NWP_FW,
 	.mac_address = NULL,
@@ -83,6 +101,105 @@ static const sl_wifi_device_configuration_t station_init_configuration = {
 	}
 };
 
+static sl_status_t _wifi_join_callback(sl_wifi_event_t event, void *data, uint32_t data_length, void *arg)
+{
+	(void)data;
+	(void)data_length;
+	(void)arg;
+
+	// Join events after the connection only report its loss
+	if (SL_WIFI_CHECK_IF_EVENT_FAILED(event))
+	{
+		_wifi_connected = false;
+		LOG_W("Wi-Fi connection lost");
+	}
+
+	return SL_STATUS_OK;
+}
+
+static void _wifi_cache_connection(void)
+{
+	sl_net_wifi_client_profile_t profile = {0};
+	if (SL_STATUS_OK != sl_net_get_profile(SL_NET_WIFI_CLIENT_INTERFACE, SL_NET_DEFAULT_WIFI_CLIENT_PROFILE_ID, &profile))
+		return;
+
+	sl_si91x_rsp_wireless_info_t info = {0};
+	if (SL_STATUS_OK != sl_wifi_get_wireless_info(&info))
+		return;
+
+	// Probe only the channel of the access point and keep the leased address
+	_wifi_fast_profile = profile;
+	_wifi_fast_profile.config.channel.channel = info.channel_number;
+	_wifi_fast_profile.ip.mode = SL_IP_MANAGEMENT_STATIC_IP;
+	_wifi_fast_valid = true;
+}
+
+sl_status_t wius_wifi_connect(void)
+{
+	sl_status_t status = SL_STATUS_FAIL;
+	uint32_t start = time_ms();
+
+	if (!_wifi_full_valid)
+	{
+		CHECK_STATUS(sl_net_get_profile(SL_NET_WIFI_CLIENT_INTERFACE, SL_NET_DEFAULT_WIFI_CLIENT_PROFILE_ID, &_wifi_full_profile));
+		_wifi_full_valid = true;
+	}
+
+	if (_wifi_fast_valid)
+	{
+		status = sl_net_set_profile(SL_NET_WIFI_CLIENT_INTERFACE, SL_NET_DEFAULT_WIFI_CLIENT_PROFILE_ID, &_wifi_fast_profile);
+		if (status == SL_STATUS_OK)
+		{
+			status = sl_net_up(SL_NET_WIFI_CLIENT_INTERFACE, SL_NET_DEFAULT_WIFI_CLIENT_PROFILE_ID);
+		}
+
+		if (status != SL_STATUS_OK)
+		{
+			// The access point moved or the lease is gone, scan all channels and ask DHCP again
+			LOG_W("Fast reconnect failed: 0x%lx", status);
+			_wifi_fast_valid = false;
+			CHECK_STATUS(sl_net_set_profile(SL_NET_WIFI_CLIENT_INTERFACE, SL_NET_DEFAULT_WIFI_CLIENT_PROFILE_ID, &_wifi_full_profile));
+		}
+	}
+
+	if (status != SL_STATUS_OK)
+	{
+		status = sl_net_up(SL_NET_WIFI_CLIENT_INTERFACE, SL_NET_DEFAULT_WIFI_CLIENT_PROFILE_ID);
+		if (status != SL_STATUS_OK)
+		{
+			LOG_E("Failed to bring Wi-Fi client interface up: 0x%lx", status);
+			if (status == 0x10003)
+			{
+				LOG_E("SSID '%s' not found", DEFAULT_WIFI_CLIENT_PROFILE_SSID);
+			}
+			else if (status == 0x10008)
+			{
+				LOG_E("PASS '%s' not accepted", DEFAULT_WIFI_CLIENT_CREDENTIAL);
+			}
+			return status;
+		}
+
+		_wifi_cache_connection();
+	}
+
+	_wifi_connected = true;
+	LOG_D("Wi-Fi client connected in %lu ms", time_ms() - start);
+
+	return status;
+}
+
+sl_status_t wius_wifi_reconnect(void)
+{
+	sl_net_down(SL_NET_WIFI_CLIENT_INTERFACE);
+
+	return wius_wifi_connect();
+}
+
+bool wius_wifi_is_connected(void)
+{
+	return _wifi_connected;
+}
+
 sl_status_t wius_wifi_init(void)
 {
 	sl_status_t status;
@@ -113,22 +230,9 @@ sl_status_t wius_wifi_init(void)
 	 printf("Failed to get mac address: 0x%lx\r\n", status);
 	 } */
 
-	status = sl_net_up(SL_NET_WIFI_CLIENT_INTERFACE,
-					   SL_NET_DEFAULT_WIFI_CLIENT_PROFILE_ID);
-	if (status != SL_STATUS_OK)
-	{
-		LOG_E("Failed to bring Wi-Fi client interface up: 0x%lx", status);
-		if (status == 0x10003)
-		{
-			LOG_E("SSID '%s' not found", DEFAULT_WIFI_CLIENT_PROFILE_SSID);
-		}
-		else if (status == 0x10008)
-		{
-			LOG_E("PASS '%s' not accepted", DEFAULT_WIFI_CLIENT_CREDENTIAL);
-		}
-		return status;
-	}
-	LOG_D("Wi-Fi client connected");
+	CHECK_STATUS(sl_wifi_set_callback(SL_WIFI_JOIN_EVENTS, _wifi_join_callback, NULL));
+
+	CHECK_STATUS(wius_wifi_connect());
 
 #if WIUS_WIFI_FILTER_BROADCAST
 	status = sl_wifi_filter_broadcast(BROADCAST_DROP_THRESHOLD, BROADCAST_IN_TIM, BROADCAST_TIM_TILL_NEXT_COMMAND);
@@ -180,6 +284,8 @@ sl_status_t wius_wifi_init(void)
 
 sl_status_t wius_wifi_deinit(void)
 {
+	_wifi_connected = false;
+
 	return sl_net_deinit(SL_NET_WIFI_CLIENT_INTERFACE);
 }
 
@@ -187,7 +293,7 @@ sl_status_t wius_wifi_set_performance_profile(wius_wifi_performance_profile_t pr
 {
 	sl_status_t status = SL_STATUS_OK;
 
-	sl_wifi_performance_profile_t set_profile;
+	sl_wifi_performance_profile_t set_profile = {0};
 
 	switch (profile)
 	{
@@ -197,6 +303,9 @@ sl_status_t wius_wifi_set_performance_profile(wius_wifi_performance_profile_t pr
 	case WIUS_PERF_PROFILE_LOWPOWER:
 		set_profile.profile = ASSOCIATED_POWER_SAVE;
 		break;
+	case WIUS_PERF_PROFILE_LOWLATENCY:
+		set_profile.profile = ASSOCIATED_POWER_SAVE_LOW_LATENCY;
+		break;
 	default:
 		LOG_W("Unknown performance profile");
 		return SL_STATUS_INVALID_PARAMETER;
@@ -204,6 +313,8 @@ sl_status_t wius_wifi_set_performance_profile(wius_wifi_performance_profile_t pr
 
 	CHECK_STATUS(sl_wifi_set_performance_profile(&set_profile));
 
+#if WIUS_WIFI_VERIFY_PROFILE
+	// Costs another round trip to the network processor
 	sl_wifi_performance_profile_t read_profile;
 	CHECK_STATUS(sl_wifi_get_performance_profile(&read_profile));
 
@@ -232,6 +343,139 @@ sl_status_t wius_wifi_set_performance_profile(wius_wifi_performance_profile_t pr
 	{
 		return SL_STATUS_SI91X_POWER_SAVE_NOT_SUPPORTED;
 	}
+#endif
 
 	return status;
 }
+
+sl_status_t wius_wifi_get_link(wius_wifi_link_t *link)
+{
+	sl_status_t status = SL_STATUS_OK;
+
+	CHECK_STATUS(sl_wifi_get_signal_strength(SL_WIFI_CLIENT_INTERFACE, &link->rssi));
+
+	sl_wifi_statistics_t statistics = {0};
+	CHECK_STATUS(sl_wifi_get_statistics(SL_WIFI_CLIENT_INTERFACE, &statistics));
+
+	link->tx_packets = statistics.tx_pkts;
+	link->tx_retries = statistics.tx_retries;
+	link->tx_failed = statistics.xretries;
+	link->rx_crc_ok = statistics.crc_pass;
+	link->rx_crc_bad = statistics.crc_fail;
+
+	return status;
+}
+
+static sl_status_t _wifi_twt_callback(sl_wifi_event_t event, void *data, uint32_t data_length, void *arg)
+{
+	(void)arg;
+
+	if (SL_WIFI_CHECK_IF_EVENT_FAILED(event))
+	{
+		LOG_W("TWT event failed: 0x%lx", event);
+		_wifi_twt_agreement.active = false;
+		return SL_STATUS_FAIL;
+	}
+
+	switch (event)
+	{
+	case SL_WIFI_TWT_UNSOLICITED_SESSION_SUCCESS_EVENT:
+	{
+		if (data_length < sizeof(sl_si91x_twt_response_t))
+			return SL_STATUS_FAIL;
+
+		const sl_si91x_twt_response_t *response = (const sl_si91x_twt_response_t *)data;
+
+		// The access point may have adjusted the requested values within the tolerances
+		// Exponents of 16 and more overflow 32 bits, such intervals saturate
+		uint64_t interval_us = (uint64_t)response->wake_int_mantissa << (response->wake_int_exp < 48 ? response->wake_int_exp : 48);
+		_wifi_twt_agreement.interval_us = interval_us > UINT32_MAX ? UINT32_MAX : (uint32_t)interval_us;
+		_wifi_twt_agreement.duration_us = (uint32_t)response->wake_duration * (response->wake_duration_unit ? 1024 : 256);
+		_wifi_twt_agreement.setup_tick = osKernelGetTickCount();
+		_wifi_twt_agreement.active = true;
+		LOG_D("TWT agreed: %lu us every %lu us", _wifi_twt_agreement.duration_us, _wifi_twt_agreement.interval_us);
+		break;
+	}
+	case SL_WIFI_TWT_TEARDOWN_SUCCESS_EVENT:
+	case SL_WIFI_TWT_AP_TEARDOWN_SUCCESS_EVENT:
+		_wifi_twt_agreement.active = false;
+		LOG_D("TWT torn down");
+		break;
+	default:
+		_wifi_twt_agreement.active = false;
+		LOG_W("TWT not active: 0x%lx", event);
+		break;
+	}
+
+	return SL_STATUS_OK;
+}
+
+static sl_wifi_twt_request_t _wifi_twt_request(uint32_t interval_us, uint32_t duration_us, bool enable)
+{
+	sl_wifi_twt_request_t request = {0};
+
+	// Interval = mantissa * 2^exponent us, keep as many mantissa bits as possible
+	uint8_t exponent = 0;
+	while ((interval_us >> exponent) > UINT16_MAX)
+		exponent++;
+
+	// Duration in units of 256 us, or 1024 us for long service periods
+	uint8_t unit = (duration_us > 255 * 256) ? 1 : 0;
+	uint32_t duration = (duration_us + (unit ? 1023 : 255)) >> (unit ? 10 : 8);
+	if (duration > 255)
+		duration = 255;
+
+	request.twt_enable = enable;
+	request.twt_flow_id = WIUS_WIFI_TWT_FLOW_ID;
+	request.wake_int_exp = exponent;
+	request.wake_int_exp_tol = exponent;
+	request.wake_int_mantissa = interval_us >> exponent;
+	request.wake_int_mantissa_tol = interval_us >> exponent;
+	request.wake_duration = duration ? duration : 1;
+	request.wake_duration_tol = request.wake_duration;
+	request.wake_duration_unit = unit;
+	request.implicit_twt = 1;
+	request.un_announced_twt = 1;
+	request.triggered_twt = 0;
+	request.restrict_tx_outside_tsp = 1;
+	request.twt_retry_limit = 6;
+	request.twt_retry_interval = 10;
+	request.req_type = 1; // suggest, the access point may adjust within the tolerances
+	request.negotiation_type = 0; // individual
+
+	return request;
+}
+
+sl_status_t wius_wifi_twt_enable(uint32_t interval_us, uint32_t duration_us)
+{
+	sl_status_t status = SL_STATUS_OK;
+
+	if (duration_us >= interval_us)
+		return SL_STATUS_INVALID_PARAMETER;
+
+	CHECK_STATUS(sl_wifi_set_callback(SL_WIFI_TWT_RESPONSE_EVENTS, _wifi_twt_callback, NULL));
+
+	_wifi_twt_agreement.active = false;
+
+	sl_wifi_twt_request_t request = _wifi_twt_request(interval_us, duration_us, true);
+	CHECK_STATUS(sl_wifi_enable_target_wake_time(&request));
+
+	return status;
+}
+
+sl_status_t wius_wifi_twt_disable(void)
+{
+	sl_wifi_twt_request_t request = _wifi_twt_request(0, 0, false);
+
+	_wifi_twt_agreement.active = false;
+
+	return sl_wifi_disable_target_wake_time(&request);
+}
+
+void wius_wifi_twt_get(wius_wifi_twt_t *twt)
+{
+	twt->active = _wifi_twt_agreement.active;
+	twt->interval_us = _wifi_twt_agreement.interval_us;
+	twt->duration_us = _wifi_twt_agreement.duration_us;
+	twt->setup_tick = _wifi_twt_agreement.setup_tick;
+}
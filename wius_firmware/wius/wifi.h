@@ -22,9 +22,36 @@
 typedef enum wius_wifi_performance_profile
 {
   WIUS_PERF_PROFILE_HIGHSPEED, /**< High speed */
-  WIUS_PERF_PROFILE_LOWPOWER   /**< Low power */
+  WIUS_PERF_PROFILE_LOWPOWER,  /**< Low power */
+  WIUS_PERF_PROFILE_LOWLATENCY /**< Low power with fast wake up on traffic */
 } wius_wifi_performance_profile_t;
 
+/**
+ * @brief Target wake time (TWT) agreement structure
+ *
+ */
+typedef struct wius_wifi_twt
+{
+  bool active;          /**< Whether an agreement with the access point is in place */
+  uint32_t interval_us; /**< Negotiated wake interval in us */
+  uint32_t duration_us; /**< Negotiated service period duration in us */
+  uint32_t setup_tick;  /**< Kernel tick the agreement was confirmed at */
+} wius_wifi_twt_t;
+
+/**
+ * @brief WiFi link statistics structure
+ *
+ */
+typedef struct wius_wifi_link
+{
+  int32_t rssi;        /**< Signal strength of the access point in dBm */
+  uint32_t tx_packets; /**< Transmitted frames */
+  uint32_t tx_retries; /**< Frame retransmissions */
+  uint32_t tx_failed;  /**< Frames dropped after the retry limit */
+  uint32_t rx_crc_ok;  /**< Received frames with a valid CRC */
+  uint32_t rx_crc_bad; /**< Received frames with a CRC error */
+} wius_wifi_link_t;
+
 /**
  * @brief Initialize the WiFi client interface
  *
@@ -43,6 +70,40 @@ sl_status_t wius_wifi_init(void);
  */
 sl_status_t wius_wifi_deinit(void);
 
+/**
+ * @brief Connect to the access point of the default profile
+ *
+ * After a first connection, the channel of the access point and the leased address are cached.
+ * Later connections only probe that channel and skip DHCP, and fall back to a full scan with
+ * DHCP if that fails.
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Connection failed
+ *
+ * @note Called by @ref wius_wifi_init
+ *
+ */
+sl_status_t wius_wifi_connect(void);
+
+/**
+ * @brief Reconnect after the connection was lost
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Connection failed
+ *
+ * @note Open sockets do not survive the reconnect, re-open them with @ref wius_udp_reopen
+ *
+ */
+sl_status_t wius_wifi_reconnect(void);
+
+/**
+ * @brief Check whether the client is connected
+ *
+ * @return Whether the client is connected
+ *
+ */
+bool wius_wifi_is_connected(void);
+
 /**
  * @brief Set the WiFi performance profile
  *
@@ -53,7 +114,54 @@ sl_status_t wius_wifi_deinit(void);
  * @retval SL_STATUS_SI91X_POWER_SAVE_NOT_SUPPORTED: Profile not applied
  * @retval other: Performance profile setting failed
  *
+ * @note The applied profile is only read back if @c WIUS_WIFI_VERIFY_PROFILE is set
+ *
  */
 sl_status_t wius_wifi_set_performance_profile(wius_wifi_performance_profile_t profile);
 
+/**
+ * @brief Read the link statistics from the network processor
+ *
+ * @param link: Pointer to store the statistics
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Reading the statistics failed
+ *
+ * @note Frame counters are reported by the network processor since the previous read
+ *
+ */
+sl_status_t wius_wifi_get_link(wius_wifi_link_t *link);
+
+/**
+ * @brief Request an individual target wake time agreement from the access point
+ *
+ * @param interval_us: Wake interval in us
+ * @param duration_us: Service period duration in us
+ *
+ * @retval SL_STATUS_OK: Request sent, the outcome is reported by @ref wius_wifi_twt_get
+ * @retval SL_STATUS_INVALID_PARAMETER: Duration not shorter than the interval
+ * @retval other: Sending the request failed
+ *
+ * @note The radio only sleeps between service periods with a power save performance profile
+ *
+ */
+sl_status_t wius_wifi_twt_enable(uint32_t interval_us, uint32_t duration_us);
+
+/**
+ * @brief Tear down the target wake time agreement
+ *
+ * @retval SL_STATUS_OK: Success
+ * @retval other: Sending the teardown failed
+ *
+ */
+sl_status_t wius_wifi_twt_disable(void);
+
+/**
+ * @brief Get the current target wake time agreement
+ *
+ * @param twt: Pointer to store the agreement
+ *
+ */
+void wius_wifi_twt_get(wius_wifi_twt_t *twt);
+
 #endif // _WIFI_H_